@@ -0,0 +1,288 @@
+/*
+ * AsyncLogger.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "SampleApp/AsyncLogger.h"
+#include "SampleApp/ConsolePrinter.h"
+#include "SampleApp/LatencyStats.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+using avsCommon::utils::logger::Level;
+
+/// The number of records in the ring.
+static const size_t RING_SIZE = 256;
+
+/// The sustained entries per second of each category until @c setRateLimit() is called.
+static const unsigned int DEFAULT_RATE = 20;
+
+/// The burst of each category until @c setRateLimit() is called.
+static const unsigned int DEFAULT_BURST = 50;
+
+/// The name given to categories beyond @c MAX_CATEGORIES, which share one bucket.
+static const char OTHER_CATEGORY[] = "(other)";
+
+/// How long suppressed and dropped entries wait to be reported when nothing else is logged.
+static const std::chrono::seconds REPORT_PERIOD{1};
+
+/// Nanoseconds per second.
+static const double NS_PER_S = 1e9;
+
+std::shared_ptr<AsyncLogger> AsyncLogger::create(Level level) {
+    return std::shared_ptr<AsyncLogger>(new AsyncLogger(level));
+}
+
+AsyncLogger::AsyncLogger(Level level) :
+        Logger{level},
+        m_records(RING_SIZE),
+        m_head{0},
+        m_tail{0},
+        m_dropped{0},
+        m_rate{DEFAULT_RATE},
+        m_burst{DEFAULT_BURST},
+        m_hasReports{false},
+        m_isWorkerWaiting{false},
+        m_isShuttingDown{false},
+        m_dateSecond{0},
+        m_dateText{} {
+    for (auto& bucket : m_buckets) {
+        bucket.hash = 0;
+        bucket.name[0] = '\0';
+        bucket.tokens = 0;
+        bucket.refillNs = 0;
+        bucket.suppressed = 0;
+    }
+    auto& other = m_buckets[MAX_CATEGORIES - 1];
+    other.hash = 1;
+    strncpy(other.name, OTHER_CATEGORY, sizeof(other.name) - 1);
+    m_worker = std::thread(&AsyncLogger::writeLoop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_isShuttingDown = true;
+    }
+    m_wake.notify_one();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void AsyncLogger::setRateLimit(unsigned int entriesPerSecond, unsigned int burst) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_rate = entriesPerSecond;
+    m_burst = std::max(burst, 1u);
+}
+
+void AsyncLogger::emit(
+    Level level,
+    std::chrono::system_clock::time_point time,
+    const char* threadMoniker,
+    const char* text) {
+    int64_t nowNs = LatencyStats::nowNs();
+    size_t length = std::min(strlen(text), MAX_TEXT_SIZE);
+    bool wakeWorker = false;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (level < Level::ERROR && !takeToken(findBucket(text), nowNs)) {
+            wakeWorker = addReport();
+        } else if (m_tail - m_head == m_records.size()) {
+            ++m_dropped;
+            wakeWorker = addReport();
+        } else {
+            queue(level, time, threadMoniker, text, length);
+            wakeWorker = m_isWorkerWaiting;
+        }
+    }
+    if (wakeWorker) {
+        m_wake.notify_one();
+    }
+}
+
+void AsyncLogger::queue(
+    Level level,
+    std::chrono::system_clock::time_point time,
+    const char* threadMoniker,
+    const char* text,
+    size_t length) {
+    auto& record = m_records[m_tail % m_records.size()];
+    record.level = level;
+    record.time = time;
+    strncpy(record.threadMoniker, threadMoniker, sizeof(record.threadMoniker) - 1);
+    record.threadMoniker[sizeof(record.threadMoniker) - 1] = '\0';
+    record.length = static_cast<uint16_t>(length);
+    memcpy(record.text, text, length);
+    ++m_tail;
+}
+
+bool AsyncLogger::addReport() {
+    // Only the first one wakes the worker, which then waits REPORT_PERIOD for more.
+    if (m_hasReports) {
+        return false;
+    }
+    m_hasReports = true;
+    return m_isWorkerWaiting;
+}
+
+AsyncLogger::Bucket& AsyncLogger::findBucket(const char* text) {
+    // The category is the source tag the entry starts with, up to the first ':'; FNV-1a hashed.
+    uint32_t hash = 2166136261u;
+    size_t length = 0;
+    while (text[length] && text[length] != ':' && length < MAX_CATEGORY_SIZE - 1) {
+        hash = (hash ^ static_cast<uint8_t>(text[length])) * 16777619u;
+        ++length;
+    }
+    // 0 marks a free bucket and 1 the shared one.
+    hash = std::max(hash, 2u);
+
+    size_t start = hash % (MAX_CATEGORIES - 1);
+    for (size_t i = 0; i < MAX_CATEGORIES - 1; ++i) {
+        auto& bucket = m_buckets[(start + i) % (MAX_CATEGORIES - 1)];
+        if (bucket.hash == hash) {
+            return bucket;
+        }
+        if (0 == bucket.hash) {
+            bucket.hash = hash;
+            memcpy(bucket.name, text, length);
+            bucket.name[length] = '\0';
+            return bucket;
+        }
+    }
+    return m_buckets[MAX_CATEGORIES - 1];
+}
+
+bool AsyncLogger::takeToken(Bucket& bucket, int64_t nowNs) {
+    if (m_rate <= 0) {
+        return true;
+    }
+    if (0 == bucket.refillNs) {
+        bucket.tokens = m_burst;
+    } else {
+        bucket.tokens = std::min(m_burst, bucket.tokens + (nowNs - bucket.refillNs) * m_rate / NS_PER_S);
+    }
+    bucket.refillNs = nowNs;
+    if (bucket.tokens < 1) {
+        ++bucket.suppressed;
+        return false;
+    }
+    bucket.tokens -= 1;
+    return true;
+}
+
+void AsyncLogger::writeLoop() {
+    std::string batch;
+    std::string reports;
+    std::unique_lock<std::mutex> lock{m_mutex};
+    auto hasWork = [this] { return m_head != m_tail || m_isShuttingDown; };
+    while (true) {
+        // Suppressed and dropped entries are reported with the next batch, or after REPORT_PERIOD if none comes.
+        bool isReportDue = false;
+        m_isWorkerWaiting = true;
+        if (m_hasReports) {
+            isReportDue = !m_wake.wait_for(lock, REPORT_PERIOD, hasWork);
+        } else {
+            m_wake.wait(lock, [this, &hasWork] { return hasWork() || m_hasReports; });
+        }
+        m_isWorkerWaiting = false;
+        if (m_head == m_tail) {
+            if (m_isShuttingDown && !m_hasReports) {
+                return;
+            }
+            if (!isReportDue && !m_isShuttingDown) {
+                continue;
+            }
+        }
+
+        // Producers only write past m_tail and never past m_head, so the records in between are read unlocked.
+        uint64_t head = m_head;
+        uint64_t tail = m_tail;
+        auto now = std::chrono::system_clock::now();
+        reports.clear();
+        for (auto& bucket : m_buckets) {
+            if (bucket.suppressed) {
+                char text[MAX_CATEGORY_SIZE + 48];
+                int length = snprintf(
+                    text,
+                    sizeof(text),
+                    "%s:suppressed:entries=%llu",
+                    bucket.name,
+                    static_cast<unsigned long long>(bucket.suppressed));
+                format(Level::WARN, now, "log", text, std::min<size_t>(length, sizeof(text) - 1), &reports);
+                bucket.suppressed = 0;
+            }
+        }
+        if (m_dropped) {
+            char text[64];
+            int length = snprintf(
+                text, sizeof(text), "AsyncLogger:ringFull:dropped=%llu", static_cast<unsigned long long>(m_dropped));
+            format(Level::WARN, now, "log", text, std::min<size_t>(length, sizeof(text) - 1), &reports);
+            m_dropped = 0;
+        }
+        m_hasReports = false;
+        lock.unlock();
+
+        batch.clear();
+        for (uint64_t i = head; i < tail; ++i) {
+            auto& record = m_records[i % m_records.size()];
+            format(record.level, record.time, record.threadMoniker, record.text, record.length, &batch);
+        }
+        batch += reports;
+        // One console write for the whole batch, without the last newline, which simplePrint() adds.
+        if (!batch.empty()) {
+            batch.pop_back();
+            ConsolePrinter::simplePrint(batch);
+        }
+
+        lock.lock();
+        m_head = tail;
+    }
+}
+
+void AsyncLogger::format(
+    Level level,
+    std::chrono::system_clock::time_point time,
+    const char* threadMoniker,
+    const char* text,
+    size_t length,
+    std::string* out) {
+    auto sinceEpoch = time.time_since_epoch();
+    auto second = std::chrono::system_clock::to_time_t(time);
+    if (second != m_dateSecond || !m_dateText[0]) {
+        std::tm utc;
+        gmtime_r(&second, &utc);
+        strftime(m_dateText, sizeof(m_dateText), "%Y-%m-%d %H:%M:%S", &utc);
+        m_dateSecond = second;
+    }
+    char prefix[96];
+    snprintf(
+        prefix,
+        sizeof(prefix),
+        "%s.%03d [%s] %c ",
+        m_dateText,
+        static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count() % 1000),
+        threadMoniker,
+        avsCommon::utils::logger::convertLevelToChar(level));
+    out->append(prefix);
+    out->append(text, length);
+    out->push_back('\n');
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
@@ -0,0 +1,175 @@
+/*
+ * BargeInHandler.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/BargeInHandler.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+using namespace avsCommon::sdkInterfaces;
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("BargeInHandler");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// The players that are ducked: speech and content, which the SDK keeps at one volume.
+static const SpeakerInterface::Type DUCKED_TYPE = SpeakerInterface::Type::AVS_SYNCED;
+
+bool BargeInHandler::parseMode(const std::string& name, Mode* mode) {
+    if ("none" == name) {
+        *mode = Mode::NONE;
+    } else if ("stop" == name) {
+        *mode = Mode::STOP;
+    } else if ("duck" == name) {
+        *mode = Mode::DUCK;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+BargeInHandler::BargeInHandler(
+    Mode mode,
+    int8_t duckVolume,
+    std::shared_ptr<SpeakerManagerInterface> speakerManager) :
+        m_mode{mode},
+        m_duckVolume{duckVolume},
+        m_speakerManager{speakerManager},
+        m_dialogState{DialogUXState::IDLE},
+        m_isShuttingDown{false},
+        m_isDucked{false},
+        m_savedVolume{0} {
+    m_worker = std::thread(&BargeInHandler::workLoop, this);
+}
+
+BargeInHandler::~BargeInHandler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isShuttingDown = true;
+    }
+    m_wake.notify_one();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+bool BargeInHandler::onWakeWord(std::shared_ptr<InteractionManager> interactionManager) {
+    // While THINKING the AudioInputProcessor is busy and refuses the tap, so only speech can be barged in on.
+    if (DialogUXState::SPEAKING != m_dialogState.load()) {
+        return false;
+    }
+    ACSDK_INFO(LX("bargeIn").d("mode", static_cast<int>(m_mode)));
+    switch (m_mode) {
+        case Mode::NONE:
+            break;
+        case Mode::STOP:
+            // Queued on the interaction manager's executor, so it runs before the tap that follows.
+            interactionManager->stop();
+            break;
+        case Mode::DUCK:
+            request(Request::DUCK);
+            break;
+    }
+    return true;
+}
+
+void BargeInHandler::onDialogUXStateChanged(DialogUXState newState) {
+    m_dialogState = newState;
+    // Called on the SDK's observer thread, which must not wait for the SpeakerManager: the worker restores.
+    if (DialogUXState::IDLE == newState && Mode::DUCK == m_mode) {
+        request(Request::RESTORE);
+    }
+}
+
+void BargeInHandler::request(Request request) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(request);
+    }
+    m_wake.notify_one();
+}
+
+void BargeInHandler::workLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return !m_requests.empty() || m_isShuttingDown; });
+        // Requests still queued at shutdown are carried out, so that a ducked volume is not left behind.
+        if (m_requests.empty()) {
+            return;
+        }
+        Request next = m_requests.front();
+        m_requests.pop_front();
+        lock.unlock();
+        if (Request::DUCK == next) {
+            duck();
+        } else {
+            restore();
+        }
+        lock.lock();
+    }
+}
+
+void BargeInHandler::duck() {
+    // Already ducked by an earlier barge-in of the same dialog: keep the volume saved then.
+    if (m_isDucked) {
+        return;
+    }
+    SpeakerInterface::SpeakerSettings settings;
+    if (!m_speakerManager->getSpeakerSettings(DUCKED_TYPE, &settings).get()) {
+        ACSDK_ERROR(LX("duckFailed").d("reason", "getSpeakerSettingsFailed"));
+        return;
+    }
+    if (settings.volume <= m_duckVolume) {
+        return;
+    }
+    // A local change: AVS is not told, and the volume it knows is put back when the dialog is idle.
+    if (!m_speakerManager->setVolume(DUCKED_TYPE, m_duckVolume, true).get()) {
+        ACSDK_ERROR(LX("duckFailed").d("reason", "setVolumeFailed"));
+        return;
+    }
+    m_isDucked = true;
+    m_savedVolume = settings.volume;
+}
+
+void BargeInHandler::restore() {
+    if (!m_isDucked) {
+        return;
+    }
+    m_isDucked = false;
+    SpeakerInterface::SpeakerSettings settings;
+    if (!m_speakerManager->getSpeakerSettings(DUCKED_TYPE, &settings).get()) {
+        ACSDK_ERROR(LX("restoreFailed").d("reason", "getSpeakerSettingsFailed"));
+        return;
+    }
+    // The user or AVS set a volume while ducked, which is newer than the saved one.
+    if (settings.volume != m_duckVolume) {
+        ACSDK_INFO(LX("restoreSkipped").d("reason", "volumeChangedWhileDucked").d("volume", settings.volume));
+        return;
+    }
+    if (!m_speakerManager->setVolume(DUCKED_TYPE, m_savedVolume, true).get()) {
+        ACSDK_ERROR(LX("restoreFailed").d("reason", "setVolumeFailed"));
+    }
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
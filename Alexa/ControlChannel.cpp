@@ -0,0 +1,202 @@
+/*
+ * ControlChannel.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <poll.h>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/ControlChannel.h"
+#include "SampleApp/LatencyStats.h"
+#include "ctlproto.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("ControlChannel");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/**
+ * Maps a state onto its protocol value.
+ *
+ * @param state The state.
+ * @return The @c ctl_state_t value.
+ */
+static uint8_t toProtocol(ControlChannel::State state) {
+    switch (state) {
+        case ControlChannel::State::DISCONNECTED:
+            return CTL_STATE_DISCONNECTED;
+        case ControlChannel::State::CONNECTING:
+            return CTL_STATE_CONNECTING;
+        case ControlChannel::State::IDLE:
+            return CTL_STATE_IDLE;
+        case ControlChannel::State::LISTENING:
+            return CTL_STATE_LISTENING;
+        case ControlChannel::State::THINKING:
+            return CTL_STATE_THINKING;
+        case ControlChannel::State::SPEAKING:
+            return CTL_STATE_SPEAKING;
+    }
+    return CTL_STATE_DISCONNECTED;
+}
+
+ControlChannel& ControlChannel::instance() {
+    static ControlChannel channel;
+    return channel;
+}
+
+ControlChannel::ControlChannel() :
+        m_fd{-1},
+        m_seq{0},
+        m_ackSeq{0},
+        m_state{State::DISCONNECTED},
+        m_hasPendingAck{false},
+        m_pendingAckSeq{0},
+        m_pendingAckNeedsState{false},
+        m_pendingAckState{State::DISCONNECTED} {
+    m_fd = ctl_open(CTL_CLIENT_PATH);
+    if (m_fd < 0) {
+        ACSDK_ERROR(LX("bindFailed").d("path", CTL_CLIENT_PATH).d("errno", errno));
+    }
+}
+
+ControlChannel::~ControlChannel() {
+    if (m_fd >= 0) {
+        close(m_fd);
+        unlink(CTL_CLIENT_PATH);
+    }
+}
+
+void ControlChannel::sendState(State state) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_state = state;
+    if (m_hasPendingAck && (!m_pendingAckNeedsState || m_pendingAckState == state)) {
+        m_ackSeq = m_pendingAckSeq;
+        m_hasPendingAck = false;
+    }
+    sendStateLocked();
+}
+
+void ControlChannel::acknowledge(uint32_t seq) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ackSeq = seq;
+    m_hasPendingAck = false;
+    sendStateLocked();
+}
+
+void ControlChannel::acknowledgeOnStateChange(uint32_t seq, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hasPendingAck = true;
+    m_pendingAckSeq = seq;
+    m_pendingAckNeedsState = false;
+    m_pendingAckDeadline = std::chrono::steady_clock::now() + timeout;
+}
+
+void ControlChannel::acknowledgeOnState(uint32_t seq, State state, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hasPendingAck = true;
+    m_pendingAckSeq = seq;
+    m_pendingAckNeedsState = true;
+    m_pendingAckState = state;
+    m_pendingAckDeadline = std::chrono::steady_clock::now() + timeout;
+}
+
+void ControlChannel::sendStateLocked() {
+    if (m_fd < 0) {
+        return;
+    }
+    ctl_state_msg_t msg = {};
+    msg.ack_seq = m_ackSeq;
+    msg.state = toProtocol(m_state);
+    ctl_header_init(&msg.hdr, CTL_STATE, ++m_seq);
+    // A recognizer that is not running yet sends a hello when it starts.
+    if (ctl_send(m_fd, CTL_RECOGNIZER_PATH, &msg, sizeof(msg)) < 0 && errno != ENOENT && errno != ECONNREFUSED) {
+        ACSDK_ERROR(LX("sendStateFailed").d("errno", errno));
+    }
+}
+
+bool ControlChannel::receiveKeyword(Keyword* keyword) {
+    if (m_fd < 0 || !keyword) {
+        return false;
+    }
+    struct pollfd pfd = {m_fd, POLLIN, 0};
+    ctl_msg_t msg;
+    while (true) {
+        int type = ctl_recv(m_fd, &msg);
+        if (type < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                ACSDK_ERROR(LX("receiveFailed").d("errno", errno));
+                return false;
+            }
+            int timeoutMs = -1;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_hasPendingAck) {
+                    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        m_pendingAckDeadline - std::chrono::steady_clock::now());
+                    if (remaining.count() <= 0) {
+                        ACSDK_WARN(LX("acknowledgedWithoutStateChange").d("seq", m_pendingAckSeq));
+                        m_ackSeq = m_pendingAckSeq;
+                        m_hasPendingAck = false;
+                        sendStateLocked();
+                    } else {
+                        timeoutMs = static_cast<int>(remaining.count()) + 1;
+                    }
+                }
+            }
+            if (poll(&pfd, 1, timeoutMs) < 0 && errno != EINTR) {
+                ACSDK_ERROR(LX("pollFailed").d("errno", errno));
+                return false;
+            }
+            continue;
+        }
+        switch (type) {
+            case CTL_HELLO: {
+                /*
+                 * A hello asking about a keyword whose acknowledgement waits for a state change is answered by that
+                 * state change; answering it now would report the state from before the keyword was acted on.
+                 */
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_hasPendingAck && m_pendingAckSeq == msg.hdr.seq) {
+                    break;
+                }
+                lock.unlock();
+                acknowledge(msg.hdr.seq);
+                break;
+            }
+            case CTL_KEYWORD:
+                LatencyStats::instance().record(
+                    LatencyStats::Stage::KEYWORD_DELIVERY, LatencyStats::nowNs() - msg.hdr.sent_ns);
+                keyword->phrase = msg.keyword.phrase;
+                keyword->id = msg.keyword.keyword_id;
+                keyword->seq = msg.hdr.seq;
+                keyword->keywordEndNs = msg.keyword.kwend_ns;
+                keyword->doaDegrees = msg.keyword.doa_deg;
+                return true;
+            default:
+                ACSDK_ERROR(LX("invalidMessageDropped").d("type", msg.hdr.type).d("version", msg.hdr.version));
+                break;
+        }
+    }
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
@@ -0,0 +1,240 @@
+/*
+ * Endpointer.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cmath>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/Endpointer.h"
+#include "SampleApp/LatencyStats.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+using avsCommon::avs::AudioInputStream;
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("Endpointer");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// The sample rate of the stream.
+static const int SAMPLE_RATE_HZ = 16000;
+
+/// Samples per analysis frame (10 ms).
+static const size_t FRAME_SAMPLES = 160;
+
+/// The duration of a frame.
+static const std::chrono::milliseconds FRAME_DURATION{10};
+
+/// How long a read waits for audio before rechecking the dialog state.
+static const std::chrono::milliseconds READ_TIMEOUT{100};
+
+/// A frame this far above the noise floor is speech.
+static const float SPEECH_MARGIN_DB = 10.0f;
+
+/// Frames quieter than this are never speech, whatever the floor (dB re 1 LSB^2).
+static const float MIN_SPEECH_DB = 20.0f;
+
+/// How fast the noise floor rises towards louder background, per frame.
+static const float FLOOR_RISE = 0.005f;
+
+/// Nanoseconds per second.
+static const int64_t NS_PER_S = 1000000000LL;
+
+const AudioInputStream::Index Endpointer::INVALID_INDEX = std::numeric_limits<AudioInputStream::Index>::max();
+
+std::shared_ptr<Endpointer> Endpointer::create(
+    std::shared_ptr<AudioInputStream> stream,
+    std::chrono::milliseconds hangover,
+    std::chrono::milliseconds minSpeech,
+    std::function<void()> onEndOfSpeech) {
+    if (!stream) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "nullStream"));
+        return nullptr;
+    }
+    if (!onEndOfSpeech) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "nullCallback"));
+        return nullptr;
+    }
+    if (hangover < FRAME_DURATION) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "hangoverTooShort").d("hangoverMs", hangover.count()));
+        return nullptr;
+    }
+    return std::shared_ptr<Endpointer>(new Endpointer(stream, hangover, minSpeech, onEndOfSpeech));
+}
+
+Endpointer::Endpointer(
+    std::shared_ptr<AudioInputStream> stream,
+    std::chrono::milliseconds hangover,
+    std::chrono::milliseconds minSpeech,
+    std::function<void()> onEndOfSpeech) :
+        m_stream{stream},
+        m_hangover{hangover},
+        m_minSpeech{minSpeech},
+        m_onEndOfSpeech{onEndOfSpeech},
+        m_isListening{false},
+        m_listenCount{0},
+        m_isShuttingDown{false},
+        m_requestBeginIndex{INVALID_INDEX},
+        m_endpointNs{0} {
+    m_thread = std::thread(&Endpointer::detectLoop, this);
+}
+
+Endpointer::~Endpointer() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_isShuttingDown = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void Endpointer::setRequestBegin(AudioInputStream::Index beginIndex) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_requestBeginIndex = beginIndex;
+}
+
+void Endpointer::onDialogUXStateChanged(DialogUXState newState) {
+    if (DialogUXState::THINKING == newState) {
+        int64_t endpointNs = m_endpointNs.exchange(0);
+        if (endpointNs) {
+            LatencyStats::instance().record(
+                LatencyStats::Stage::ENDPOINT_TO_THINKING, LatencyStats::nowNs() - endpointNs);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        bool isListening = DialogUXState::LISTENING == newState;
+        if (isListening && !m_isListening) {
+            ++m_listenCount;
+            // An endpoint that did not lead to THINKING is not carried over to the next request.
+            m_endpointNs = 0;
+        }
+        m_isListening = isListening;
+    }
+    m_wake.notify_all();
+}
+
+bool Endpointer::isStillListening(uint64_t listenCount) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_isListening && m_listenCount == listenCount && !m_isShuttingDown;
+}
+
+void Endpointer::detectLoop() {
+    uint64_t handled = 0;
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+        // Each LISTENING is handled once, whether or not it ends in an endpoint.
+        m_wake.wait(lock, [this, handled] { return m_isShuttingDown || (m_isListening && m_listenCount != handled); });
+        if (m_isShuttingDown) {
+            return;
+        }
+        handled = m_listenCount;
+        auto beginIndex = m_requestBeginIndex;
+        m_requestBeginIndex = INVALID_INDEX;
+        lock.unlock();
+        if (detect(handled, beginIndex)) {
+            m_onEndOfSpeech();
+        }
+        lock.lock();
+    }
+}
+
+bool Endpointer::detect(uint64_t listenCount, AudioInputStream::Index beginIndex) {
+    auto reader = m_stream->createReader(AudioInputStream::Reader::Policy::BLOCKING);
+    if (!reader) {
+        ACSDK_ERROR(LX("detectFailed").d("reason", "createReaderFailed"));
+        return false;
+    }
+    // The request starts before LISTENING, at the end of the wake word; what was said since counts as speech too.
+    if (INVALID_INDEX == beginIndex || !reader->seek(beginIndex)) {
+        if (INVALID_INDEX != beginIndex) {
+            ACSDK_WARN(LX("detect").d("reason", "beginIndexUnavailable").d("beginIndex", beginIndex));
+        }
+        if (!reader->seek(0, AudioInputStream::Reader::Reference::BEFORE_WRITER)) {
+            ACSDK_ERROR(LX("detectFailed").d("reason", "seekFailed"));
+            reader->close();
+            return false;
+        }
+    }
+
+    int16_t frame[FRAME_SAMPLES];
+    bool haveFloor = false;
+    float floorDb = 0.0f;
+    std::chrono::milliseconds speech{0};
+    std::chrono::milliseconds silence{0};
+    int64_t speechEndNs = 0;
+
+    while (isStillListening(listenCount)) {
+        ssize_t words = reader->read(frame, FRAME_SAMPLES, READ_TIMEOUT);
+        if (AudioInputStream::Reader::Error::TIMEDOUT == words) {
+            continue;
+        }
+        if (AudioInputStream::Reader::Error::OVERRUN == words) {
+            // Fell a whole buffer behind; the audio skipped is not known to be silence, so start counting again.
+            reader->seek(0, AudioInputStream::Reader::Reference::BEFORE_WRITER);
+            silence = std::chrono::milliseconds(0);
+            continue;
+        }
+        if (words <= 0) {
+            ACSDK_ERROR(LX("detectFailed").d("reason", "readFailed").d("result", words));
+            break;
+        }
+
+        int64_t sum = 0;
+        for (ssize_t i = 0; i < words; ++i) {
+            sum += static_cast<int32_t>(frame[i]) * frame[i];
+        }
+        float energyDb = 10.0f * std::log10(static_cast<float>(sum) / words + 1.0f);
+        if (!haveFloor || energyDb < floorDb) {
+            floorDb = energyDb;
+            haveFloor = true;
+        } else {
+            floorDb += FLOOR_RISE * (energyDb - floorDb);
+        }
+
+        if (energyDb > floorDb + SPEECH_MARGIN_DB && energyDb > MIN_SPEECH_DB) {
+            speech += FRAME_DURATION;
+            silence = std::chrono::milliseconds(0);
+            // When the frame was captured: now, less the audio still queued behind it.
+            speechEndNs = LatencyStats::nowNs() -
+                          static_cast<int64_t>(reader->tell(AudioInputStream::Reader::Reference::BEFORE_WRITER)) *
+                              NS_PER_S / SAMPLE_RATE_HZ;
+            continue;
+        }
+        silence += FRAME_DURATION;
+        if (speech >= m_minSpeech && silence >= m_hangover) {
+            int64_t nowNs = LatencyStats::nowNs();
+            LatencyStats::instance().record(LatencyStats::Stage::SPEECH_END_TO_ENDPOINT, nowNs - speechEndNs);
+            m_endpointNs = nowNs;
+            ACSDK_INFO(LX("endOfSpeech").d("speechMs", speech.count()).d("silenceMs", silence.count()));
+            reader->close();
+            return true;
+        }
+    }
+    reader->close();
+    return false;
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
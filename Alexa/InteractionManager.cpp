@@ -16,6 +16,7 @@
  */
 
 #include "SampleApp/InteractionManager.h"
+#include "SampleApp/LatencyStats.h"
 
 namespace alexaClientSDK {
 namespace sampleApp {
@@ -37,16 +38,20 @@ InteractionManager::InteractionManager(
         m_isHoldOccurring{false},
         m_isTapOccurring{false},
         m_isMicOn{true} {
-    m_micWrapper->startStreamingMicrophoneData();
+    // There is no microphone wrapper when the audio comes from the recognizer's shared-memory ring.
+    if (m_micWrapper) {
+        m_micWrapper->startStreamingMicrophoneData();
+    }
 };
 
-void InteractionManager::tap() {
-    m_executor.submit([this]() {
+void InteractionManager::tap(avsCommon::avs::AudioInputStream::Index beginIndex) {
+    m_executor.submit([this, beginIndex]() {
         if (!m_isMicOn) {
             return;
         }
         if (!m_isTapOccurring) {
-            if (m_client->notifyOfTapToTalk(m_tapToTalkAudioProvider).get()) {
+            if (m_client->notifyOfTapToTalk(m_tapToTalkAudioProvider, beginIndex).get()) {
+                LatencyStats::instance().recordSinceKeyword(LatencyStats::Stage::KEYWORD_TO_TAP);
                 m_isTapOccurring = true;
             }
         } else {
@@ -56,18 +61,35 @@ void InteractionManager::tap() {
     });
 }
 
+void InteractionManager::stop() {
+    m_executor.submit([this]() { m_client->stopForegroundActivity(); });
+}
+
+void InteractionManager::adjustVolume(avsCommon::sdkInterfaces::SpeakerInterface::Type type, int8_t delta) {
+    m_executor.submit([this, type, delta]() {
+        /*
+         * Group the unmute action as part of the same affordance that caused a volume change, so we don't send
+         * another event. This isn't a requirement by AVS.
+         */
+        std::future<bool> unmuteFuture = m_client->getSpeakerManager()->setMute(type, false, true);
+        if (!unmuteFuture.valid()) {
+            return;
+        }
+        unmuteFuture.get();
+
+        std::future<bool> future = m_client->getSpeakerManager()->adjustVolume(type, delta);
+        if (!future.valid()) {
+            return;
+        }
+        future.get();
+    });
+}
+
 void InteractionManager::onDialogUXStateChanged(DialogUXState state) {
     // reset tap-to-talk state
     if (DialogUXState::LISTENING != state) {
         m_isTapOccurring = false;
     }
-    
-    if (DialogUXState::IDLE == state) {
-        if (m_userInterface->soundControl == 1) {
-            m_micWrapper->rePortAudioMicrophoneWrapper();
-            m_userInterface->soundControl = 0;
-        }
-    }
 }
 
 void InteractionManager::doShutdown() {
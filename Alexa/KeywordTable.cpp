@@ -0,0 +1,180 @@
+/*
+ * KeywordTable.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/KeywordTable.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("KeywordTable");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// The longest phrase the recognizer can send to the client (@c KEYWORD_MAX_LEN less the terminating NUL).
+static const size_t MAX_PHRASE_LENGTH = 127;
+
+/**
+ * Splits a phrase into words and joins them with single spaces, which is how the recognizer reports it.
+ *
+ * @param phrase The phrase as written in the table.
+ * @return The normalized phrase.
+ */
+static std::string normalizePhrase(const std::string& phrase) {
+    std::istringstream words(phrase);
+    std::string word;
+    std::string normalized;
+    while (words >> word) {
+        if (!normalized.empty()) {
+            normalized += ' ';
+        }
+        normalized += word;
+    }
+    return normalized;
+}
+
+std::unique_ptr<KeywordTable> KeywordTable::create(const std::string& path, const std::string& corpusPath) {
+    std::unique_ptr<KeywordTable> table(new KeywordTable);
+    std::string line;
+
+    std::ifstream tableFile(path);
+    if (tableFile) {
+        // The recognizer reads the same file, so bad lines are skipped as it skips them rather than failing the table.
+        for (int lineNumber = 1; std::getline(tableFile, line); ++lineNumber) {
+            if (!table->addLine(line)) {
+                ACSDK_WARN(LX("invalidLineSkipped").d("path", path).d("lineNumber", lineNumber).d("line", line));
+            }
+        }
+    } else {
+        std::ifstream corpusFile(corpusPath);
+        std::string lastLine;
+        while (std::getline(corpusFile, line)) {
+            if (!normalizePhrase(line).empty()) {
+                lastLine = line;
+            }
+        }
+        // The corpus file has no thresholds or actions, so keep the slashes out of its phrase.
+        if (lastLine.find('/') == std::string::npos && !table->addLine(lastLine)) {
+            return nullptr;
+        }
+    }
+
+    if (table->m_keywords.empty()) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "noKeywords").d("path", path).d("corpusPath", corpusPath));
+        return nullptr;
+    }
+
+    // A keyphrase search reports a phrase as soon as it hears it, so a phrase that starts a longer one gets in the way.
+    for (const auto& shorter : table->m_keywords) {
+        const std::string& phrase = shorter.first;
+        for (const auto& longer : table->m_keywords) {
+            if (longer.first.size() > phrase.size() && 0 == longer.first.compare(0, phrase.size(), phrase) &&
+                ' ' == longer.first[phrase.size()]) {
+                ACSDK_WARN(LX("keywordStartsLongerKeyword")
+                               .d("keyword", phrase)
+                               .d("longerKeyword", longer.first)
+                               .d("path", path));
+            }
+        }
+    }
+    return table;
+}
+
+bool KeywordTable::addLine(const std::string& line) {
+    auto start = line.find_first_not_of(" \t\r");
+    if (std::string::npos == start || '#' == line[start]) {
+        return true;
+    }
+
+    Keyword keyword{"", -1.0, Action::TAP, 0};
+    auto open = line.find('/');
+    keyword.phrase = normalizePhrase(line.substr(0, open));
+    if (keyword.phrase.empty() || keyword.phrase.size() > MAX_PHRASE_LENGTH) {
+        return false;
+    }
+
+    if (std::string::npos != open) {
+        auto close = line.find('/', open + 1);
+        if (std::string::npos == close) {
+            return false;
+        }
+        std::string threshold = line.substr(open + 1, close - open - 1);
+        char* end;
+        keyword.threshold = std::strtod(threshold.c_str(), &end);
+        if (end == threshold.c_str() || std::string(end).find_first_not_of(" \t") != std::string::npos) {
+            return false;
+        }
+
+        std::istringstream rest(line.substr(close + 1));
+        std::string action;
+        if (rest >> action) {
+            if ("tap" == action) {
+                keyword.action = Action::TAP;
+            } else if ("stop" == action) {
+                keyword.action = Action::STOP;
+            } else if ("volume" == action && rest >> keyword.volumeDelta) {
+                keyword.action = Action::VOLUME;
+            } else {
+                return false;
+            }
+            std::string extra;
+            if (rest >> extra) {
+                return false;
+            }
+        }
+    }
+
+    if (!m_keywords.insert({keyword.phrase, keyword}).second) {
+        ACSDK_WARN(LX("duplicateKeywordIgnored").d("keyword", keyword.phrase).d("reason", "firstOneIsKept"));
+    }
+    return true;
+}
+
+const KeywordTable::Keyword* KeywordTable::find(const std::string& phrase) const {
+    auto it = m_keywords.find(phrase);
+    return m_keywords.end() == it ? nullptr : &it->second;
+}
+
+bool KeywordTable::writeKwsFile(const std::string& path, double defaultThreshold) const {
+    std::ofstream out(path, std::ios::trunc);
+    for (const auto& entry : m_keywords) {
+        const Keyword& keyword = entry.second;
+        out << keyword.phrase << " /" << (keyword.threshold < 0 ? defaultThreshold : keyword.threshold) << "/\n";
+    }
+    out.close();
+    if (!out) {
+        ACSDK_ERROR(LX("writeKwsFileFailed").d("path", path));
+        return false;
+    }
+    return true;
+}
+
+size_t KeywordTable::size() const {
+    return m_keywords.size();
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
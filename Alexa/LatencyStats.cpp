@@ -0,0 +1,190 @@
+/*
+ * LatencyStats.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <time.h>
+
+#include "SampleApp/LatencyStats.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/// The names of the stages, in @c Stage order.
+static const char* STAGE_NAMES[] = {"keyword_to_receive",
+                                    "keyword_to_tap",
+                                    "keyword_to_listening",
+                                    "keyword_delivery",
+                                    "speech_end_to_endpoint",
+                                    "endpoint_to_thinking",
+                                    "boot_to_listening",
+                                    "thinking_to_speaking"};
+
+/// Nanoseconds per microsecond.
+static const int64_t NS_PER_US = 1000;
+
+/// Nanoseconds per millisecond, as used in the dump.
+static const double NS_PER_MS = 1e6;
+
+/**
+ * Maps a latency onto its histogram bucket: 4 * (most significant bit of the microseconds) plus the two bits below
+ * it.
+ *
+ * @param ns The latency in nanoseconds.
+ * @return The bucket index.
+ */
+static int bucketOf(int64_t ns) {
+    uint64_t us = ns > 0 ? static_cast<uint64_t>(ns) / NS_PER_US : 0;
+    if (us < 4) {
+        return static_cast<int>(us);
+    }
+    int msb = 63;
+    while (!(us >> msb)) {
+        --msb;
+    }
+    return msb * 4 + static_cast<int>((us >> (msb - 2)) & 3);
+}
+
+/**
+ * Gets the exclusive upper bound of a bucket.
+ *
+ * @param bucket The bucket index.
+ * @return The upper bound in nanoseconds.
+ */
+static int64_t bucketUpperNs(int bucket) {
+    if (bucket < 4) {
+        return (bucket + 1) * NS_PER_US;
+    }
+    int msb = bucket / 4;
+    return static_cast<int64_t>((static_cast<uint64_t>(4 + bucket % 4 + 1) << (msb - 2)) * NS_PER_US);
+}
+
+LatencyStats& LatencyStats::instance() {
+    static LatencyStats stats;
+    return stats;
+}
+
+int64_t LatencyStats::nowNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+LatencyStats::LatencyStats() : m_keywordEndNs{0}, m_pendingStages{0}, m_isShuttingDown{false} {
+    for (auto& histogram : m_histograms) {
+        for (auto& bucket : histogram.buckets) {
+            bucket = 0;
+        }
+        histogram.count = 0;
+        histogram.maxNs = 0;
+    }
+}
+
+LatencyStats::~LatencyStats() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_isShuttingDown = true;
+    }
+    m_wakeDumpThread.notify_all();
+    if (m_dumpThread.joinable()) {
+        m_dumpThread.join();
+    }
+}
+
+void LatencyStats::markKeyword(int64_t keywordEndNs) {
+    m_keywordEndNs = keywordEndNs;
+    m_pendingStages = (1u << static_cast<int>(Stage::COUNT)) - 1;
+}
+
+void LatencyStats::recordSinceKeyword(Stage stage) {
+    uint32_t bit = 1u << static_cast<int>(stage);
+    if (m_pendingStages.fetch_and(~bit) & bit) {
+        record(stage, nowNs() - m_keywordEndNs);
+    }
+}
+
+void LatencyStats::record(Stage stage, int64_t latencyNs) {
+    auto& histogram = m_histograms[static_cast<size_t>(stage)];
+    int bucket = bucketOf(latencyNs);
+    if (bucket >= NUM_BUCKETS) {
+        bucket = NUM_BUCKETS - 1;
+    }
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t maxNs = histogram.maxNs.load(std::memory_order_relaxed);
+    while (latencyNs > maxNs && !histogram.maxNs.compare_exchange_weak(maxNs, latencyNs)) {
+    }
+}
+
+int64_t LatencyStats::percentileNs(const Histogram& histogram, double percentile) {
+    uint32_t count = histogram.count.load(std::memory_order_relaxed);
+    int64_t maxNs = histogram.maxNs.load(std::memory_order_relaxed);
+    if (0 == count) {
+        return 0;
+    }
+    uint32_t rank = static_cast<uint32_t>(percentile * count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (int bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+        seen += histogram.buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketUpperNs(bucket), maxNs);
+        }
+    }
+    return maxNs;
+}
+
+std::string LatencyStats::dump() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < m_histograms.size(); ++i) {
+        const auto& histogram = m_histograms[i];
+        oss << std::left << std::setw(24) << STAGE_NAMES[i] << " count=" << histogram.count.load()
+            << " p50=" << percentileNs(histogram, 0.50) / NS_PER_MS << "ms"
+            << " p95=" << percentileNs(histogram, 0.95) / NS_PER_MS << "ms"
+            << " p99=" << percentileNs(histogram, 0.99) / NS_PER_MS << "ms"
+            << " max=" << histogram.maxNs.load() / NS_PER_MS << "ms\n";
+    }
+    return oss.str();
+}
+
+void LatencyStats::startDumping(const std::string& path, std::chrono::seconds period) {
+    if (path.empty() || m_dumpThread.joinable()) {
+        return;
+    }
+    m_dumpThread = std::thread(&LatencyStats::dumpLoop, this, path, period);
+}
+
+void LatencyStats::dumpLoop(std::string path, std::chrono::seconds period) {
+    std::string tmpPath = path + ".tmp";
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (!m_wakeDumpThread.wait_for(lock, period, [this] { return m_isShuttingDown; })) {
+        // Write a temporary file and rename it, so readers never see a partial snapshot.
+        {
+            std::ofstream out(tmpPath, std::ios::trunc);
+            out << dump();
+        }
+        std::rename(tmpPath.c_str(), path.c_str());
+    }
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
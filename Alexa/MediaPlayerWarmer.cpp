@@ -0,0 +1,138 @@
+/*
+ * MediaPlayerWarmer.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/LatencyStats.h"
+#include "SampleApp/MediaPlayerWarmer.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+using avsCommon::utils::mediaPlayer::ErrorType;
+using avsCommon::utils::mediaPlayer::MediaPlayerInterface;
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("MediaPlayerWarmer");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/**
+ * The header of an MPEG-2 Layer III frame: 32 kbit/s, 24 kHz, mono, no CRC. AVS speech is MP3, so this loads the
+ * same typefinder, parser and decoder plugins that the first reply needs.
+ */
+static const unsigned char SILENT_MP3_FRAME_HEADER[] = {0xff, 0xf3, 0x44, 0xc0};
+
+/// The size of one frame: 72 * 32000 / 24000 bytes. With zero side information and no main data it decodes to silence.
+static const size_t SILENT_MP3_FRAME_SIZE = 96;
+
+/// The number of frames, 24 ms each; the typefinder wants several consecutive frame headers.
+static const int SILENT_MP3_FRAMES = 8;
+
+/// Nanoseconds per millisecond.
+static const int64_t NS_PER_MS = 1000000;
+
+/**
+ * Builds an MP3 file of silence.
+ *
+ * @return The file.
+ */
+static std::string makeSilentMp3() {
+    std::string frame(reinterpret_cast<const char*>(SILENT_MP3_FRAME_HEADER), sizeof(SILENT_MP3_FRAME_HEADER));
+    frame.resize(SILENT_MP3_FRAME_SIZE, '\0');
+    std::string mp3;
+    mp3.reserve(SILENT_MP3_FRAME_SIZE * SILENT_MP3_FRAMES);
+    for (int i = 0; i < SILENT_MP3_FRAMES; ++i) {
+        mp3 += frame;
+    }
+    return mp3;
+}
+
+bool MediaPlayerWarmer::warm(std::shared_ptr<MediaPlayerInterface> player, std::chrono::milliseconds timeout) {
+    if (!player) {
+        ACSDK_ERROR(LX("warmFailed").d("reason", "nullPlayer"));
+        return false;
+    }
+    int64_t startNs = LatencyStats::nowNs();
+    auto warmer = std::shared_ptr<MediaPlayerWarmer>(new MediaPlayerWarmer());
+    player->setObserver(warmer);
+
+    auto id = player->setSource(std::make_shared<std::istringstream>(makeSilentMp3()), false);
+    bool succeeded = false;
+    if (MediaPlayerInterface::ERROR == id) {
+        ACSDK_ERROR(LX("warmFailed").d("reason", "setSourceFailed"));
+    } else if (!player->play(id)) {
+        ACSDK_ERROR(LX("warmFailed").d("reason", "playFailed"));
+    } else {
+        succeeded = warmer->waitForFinish(timeout);
+        if (!succeeded) {
+            ACSDK_WARN(LX("warmIncomplete").d("timeoutMs", timeout.count()));
+            player->stop(id);
+        }
+    }
+    player->setObserver(nullptr);
+
+    ACSDK_INFO(LX("warmed").d("succeeded", succeeded).d("ms", (LatencyStats::nowNs() - startNs) / NS_PER_MS));
+    return succeeded;
+}
+
+MediaPlayerWarmer::MediaPlayerWarmer() : m_isFinished{false}, m_succeeded{false} {
+}
+
+void MediaPlayerWarmer::onPlaybackStarted(SourceId id) {
+}
+
+void MediaPlayerWarmer::onPlaybackFinished(SourceId id) {
+    finish(true);
+}
+
+void MediaPlayerWarmer::onPlaybackError(SourceId id, const ErrorType& type, std::string error) {
+    ACSDK_ERROR(LX("warmFailed").d("reason", "playbackError").d("error", error));
+    finish(false);
+}
+
+void MediaPlayerWarmer::onPlaybackStopped(SourceId id) {
+    finish(false);
+}
+
+void MediaPlayerWarmer::finish(bool succeeded) {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_isFinished) {
+            return;
+        }
+        m_isFinished = true;
+        m_succeeded = succeeded;
+    }
+    m_wake.notify_all();
+}
+
+bool MediaPlayerWarmer::waitForFinish(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_wake.wait_for(lock, timeout, [this] { return m_isFinished; });
+    return m_isFinished && m_succeeded;
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
@@ -0,0 +1,268 @@
+/*
+ * PocketsphinxKeywordDetector.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/PocketsphinxKeywordDetector.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+using namespace avsCommon::avs;
+using namespace avsCommon::sdkInterfaces;
+using namespace avsCommon::utils;
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("PocketsphinxKeywordDetector");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// The number of hertz per kilohertz.
+static const size_t HERTZ_PER_KILOHERTZ = 1000;
+
+/// The only sample rate the acoustic models shipped for this device are trained on.
+static const unsigned int POCKETSPHINX_COMPATIBLE_SAMPLE_RATE = 16000;
+
+/// The number of decoder frames per second (the Sphinx @c -frate default).
+static const unsigned int POCKETSPHINX_FRAMES_PER_SECOND = 100;
+
+/// The timeout to use for read calls to the SharedDataStream.
+const std::chrono::milliseconds TIMEOUT_FOR_READ_CALLS = std::chrono::milliseconds(1000);
+
+std::unique_ptr<PocketsphinxKeywordDetector> PocketsphinxKeywordDetector::create(
+    std::shared_ptr<AudioInputStream> stream,
+    AudioFormat audioFormat,
+    std::unordered_set<std::shared_ptr<KeyWordObserverInterface>> keyWordObservers,
+    std::unordered_set<std::shared_ptr<KeyWordDetectorStateObserverInterface>> keyWordDetectorStateObservers,
+    const std::string& hmmPath,
+    const std::string& dictPath,
+    const std::string& kwsPath,
+    std::chrono::milliseconds msToPushIntoEngine) {
+    if (!stream) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "nullStream"));
+        return nullptr;
+    }
+    if (kwsPath.empty()) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "emptyKeywordFile"));
+        return nullptr;
+    }
+    if (isByteswappingRequired(audioFormat)) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "bigEndianAudioNotSupported"));
+        return nullptr;
+    }
+    if (audioFormat.encoding != avsCommon::utils::AudioFormat::Encoding::LPCM) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "audioEncodingUnsupported"));
+        return nullptr;
+    }
+    if (audioFormat.sampleRateHz != POCKETSPHINX_COMPATIBLE_SAMPLE_RATE) {
+        ACSDK_ERROR(LX("createFailed")
+                        .d("reason", "unsupportedSampleRate")
+                        .d("sampleRate", audioFormat.sampleRateHz));
+        return nullptr;
+    }
+    if (audioFormat.sampleSizeInBits != 16) {
+        ACSDK_ERROR(LX("createFailed")
+                        .d("reason", "unsupportedSampleSize")
+                        .d("sampleSize", audioFormat.sampleSizeInBits));
+        return nullptr;
+    }
+    if (audioFormat.numChannels != 1) {
+        ACSDK_ERROR(LX("createFailed")
+                        .d("reason", "unsupportedNumChannels")
+                        .d("numChannels", audioFormat.numChannels));
+        return nullptr;
+    }
+
+    std::unique_ptr<PocketsphinxKeywordDetector> detector(new PocketsphinxKeywordDetector(
+        stream, audioFormat, keyWordObservers, keyWordDetectorStateObservers, msToPushIntoEngine));
+    if (!detector->init(hmmPath, dictPath, kwsPath)) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "initDetectorFailed"));
+        return nullptr;
+    }
+    return detector;
+}
+
+PocketsphinxKeywordDetector::~PocketsphinxKeywordDetector() {
+    m_isShuttingDown = true;
+    if (m_detectionThread.joinable()) {
+        m_detectionThread.join();
+    }
+    if (m_decoder) {
+        ps_free(m_decoder);
+    }
+    if (m_config) {
+        cmd_ln_free_r(m_config);
+    }
+}
+
+PocketsphinxKeywordDetector::PocketsphinxKeywordDetector(
+    std::shared_ptr<AudioInputStream> stream,
+    AudioFormat audioFormat,
+    std::unordered_set<std::shared_ptr<KeyWordObserverInterface>> keyWordObservers,
+    std::unordered_set<std::shared_ptr<KeyWordDetectorStateObserverInterface>> keyWordDetectorStateObservers,
+    std::chrono::milliseconds msToPushIntoEngine) :
+        AbstractKeywordDetector(keyWordObservers, keyWordDetectorStateObservers),
+        m_isShuttingDown{false},
+        m_stream{stream},
+        m_config{nullptr},
+        m_decoder{nullptr},
+        m_utteranceBeginIndex{0},
+        m_samplesPerFrame{audioFormat.sampleRateHz / POCKETSPHINX_FRAMES_PER_SECOND},
+        m_maxSamplesPerPush{(audioFormat.sampleRateHz / HERTZ_PER_KILOHERTZ) * msToPushIntoEngine.count()} {
+}
+
+bool PocketsphinxKeywordDetector::init(
+    const std::string& hmmPath,
+    const std::string& dictPath,
+    const std::string& kwsPath) {
+    m_streamReader = m_stream->createReader(AudioInputStream::Reader::Policy::BLOCKING);
+    if (!m_streamReader) {
+        ACSDK_ERROR(LX("initFailed").d("reason", "createStreamReaderFailed"));
+        return false;
+    }
+
+    m_config = cmd_ln_init(
+        nullptr,
+        ps_args(),
+        TRUE,
+        "-hmm",
+        hmmPath.c_str(),
+        "-dict",
+        dictPath.c_str(),
+        "-kws",
+        kwsPath.c_str(),
+        "-logfn",
+        "/dev/null",
+        nullptr);
+    if (!m_config) {
+        ACSDK_ERROR(LX("initFailed").d("reason", "invalidDecoderConfig"));
+        return false;
+    }
+
+    m_decoder = ps_init(m_config);
+    if (!m_decoder) {
+        ACSDK_ERROR(LX("initFailed")
+                        .d("reason", "psInitFailed")
+                        .d("hmm", hmmPath)
+                        .d("dict", dictPath)
+                        .d("kws", kwsPath));
+        return false;
+    }
+
+    if (ps_start_utt(m_decoder) < 0) {
+        ACSDK_ERROR(LX("initFailed").d("reason", "psStartUttFailed"));
+        return false;
+    }
+    m_utteranceBeginIndex = m_streamReader->tell();
+
+    m_isShuttingDown = false;
+    m_detectionThread = std::thread(&PocketsphinxKeywordDetector::detectionLoop, this);
+    return true;
+}
+
+bool PocketsphinxKeywordDetector::restartUtterance() {
+    ps_end_utt(m_decoder);
+    if (ps_start_utt(m_decoder) < 0) {
+        ACSDK_ERROR(LX("restartUtteranceFailed").d("reason", "psStartUttFailed"));
+        return false;
+    }
+    m_utteranceBeginIndex = m_streamReader->tell();
+    return true;
+}
+
+void PocketsphinxKeywordDetector::detectionLoop() {
+    notifyKeyWordDetectorStateObservers(KeyWordDetectorStateObserverInterface::KeyWordDetectorState::ACTIVE);
+    std::vector<int16_t> audioDataToPush(m_maxSamplesPerPush);
+    ssize_t wordsRead;
+    while (!m_isShuttingDown) {
+        bool didErrorOccur = false;
+        wordsRead = readFromStream(
+            m_streamReader,
+            m_stream,
+            audioDataToPush.data(),
+            m_maxSamplesPerPush,
+            TIMEOUT_FOR_READ_CALLS,
+            &didErrorOccur);
+        if (didErrorOccur) {
+            break;
+        } else if (AudioInputStream::Reader::Error::OVERRUN == wordsRead) {
+            // readFromStream() moved the reader up to the writer; frame counts from the old start no longer match.
+            if (!restartUtterance()) {
+                notifyKeyWordDetectorStateObservers(
+                    KeyWordDetectorStateObserverInterface::KeyWordDetectorState::ERROR);
+                break;
+            }
+        } else if (wordsRead > 0) {
+            if (ps_process_raw(m_decoder, audioDataToPush.data(), wordsRead, FALSE, FALSE) < 0) {
+                ACSDK_ERROR(LX("detectionLoopFailed").d("reason", "psProcessRawFailed"));
+                notifyKeyWordDetectorStateObservers(
+                    KeyWordDetectorStateObserverInterface::KeyWordDetectorState::ERROR);
+                break;
+            }
+
+            // The keyword search reports a keyword as soon as its score crosses that keyword's threshold.
+            const char* hyp = ps_get_hyp(m_decoder, nullptr);
+            if (hyp != nullptr) {
+                // The hypothesis belongs to the decoder and does not survive the restart below.
+                std::string keyword(hyp);
+                AudioInputStream::Index endIndex = m_streamReader->tell();
+                AudioInputStream::Index beginIndex = KeyWordObserverInterface::UNSPECIFIED_INDEX;
+
+                // The hypothesis joins every keyphrase spotted since the restart, one segment each, as in
+                // "alexa alexa stop". Report the one that ended last, the longer one if two ended together.
+                int lastStartFrame = 0, lastEndFrame = -1;
+                for (ps_seg_t* segment = ps_seg_iter(m_decoder); segment; segment = ps_seg_next(segment)) {
+                    const char* word = ps_seg_word(segment);
+                    int startFrame, endFrame;
+                    ps_seg_frames(segment, &startFrame, &endFrame);
+                    if (endFrame > lastEndFrame || (endFrame == lastEndFrame && strlen(word) > keyword.size())) {
+                        keyword = word;
+                        lastStartFrame = startFrame;
+                        lastEndFrame = endFrame;
+                    }
+                }
+                if (lastEndFrame >= 0) {
+                    beginIndex = m_utteranceBeginIndex +
+                                 static_cast<AudioInputStream::Index>(lastStartFrame) * m_samplesPerFrame;
+                    endIndex = std::min(
+                        endIndex,
+                        m_utteranceBeginIndex +
+                            static_cast<AudioInputStream::Index>(lastEndFrame + 1) * m_samplesPerFrame);
+                }
+
+                notifyKeyWordObservers(m_stream, keyword, beginIndex, endIndex);
+
+                if (!restartUtterance()) {
+                    notifyKeyWordDetectorStateObservers(
+                        KeyWordDetectorStateObserverInterface::KeyWordDetectorState::ERROR);
+                    break;
+                }
+            }
+        }
+    }
+    m_streamReader->close();
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
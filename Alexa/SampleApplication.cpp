@@ -15,11 +15,20 @@
  * permissions and limitations under the License.
  */
 
+#include "SampleApp/AsyncLogger.h"
+#include "SampleApp/BargeInHandler.h"
 #include "SampleApp/ConnectionObserver.h"
+#include "SampleApp/ControlChannel.h"
+#include "SampleApp/Endpointer.h"
 #include "SampleApp/GuiRenderer.h"
+#include "SampleApp/KeywordTable.h"
+#include "SampleApp/LatencyStats.h"
+#include "SampleApp/MediaPlayerWarmer.h"
 #include "SampleApp/SampleApplication.h"
+#include "SampleApp/ShmAudioSource.h"
 
 #include <AVSCommon/AVS/Initialization/AlexaClientSDKInit.h>
+#include <AVSCommon/SDKInterfaces/SpeakerInterface.h>
 #include <AVSCommon/Utils/Configuration/ConfigurationNode.h>
 #include <AVSCommon/Utils/LibcurlUtils/HTTPContentFetcherFactory.h>
 #include <AVSCommon/Utils/Logger/LoggerSinkManager.h>
@@ -30,27 +39,29 @@
 #include <Notifications/SQLiteNotificationsStorage.h>
 #include <Settings/SQLiteSettingStorage.h>
 
+#ifdef KWD_POCKETSPHINX
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <AVSCommon/SDKInterfaces/KeyWordObserverInterface.h>
+#include "SampleApp/PocketsphinxKeywordDetector.h"
+#endif
+
 #include <algorithm>
 #include <cctype>
 #include <fstream>
+#include <future>
+#include <time.h>
 
 // 2018/05/04 Bling Added
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
-
-struct my_msgbuf {
-    long mtype;
-    char mtext[20];
-};
+#include <sys/stat.h>
 
-FILE *saFile;
-char saBuffer[20];
-
-const std::string& logLevel = "NONE";
+/// The log level when neither @c LOG_LEVEL_ENV nor the @c logLevel configuration value is set.
+const std::string& logLevel = "WARN";
 const std::string& pathToConfig = "/home/parallels/AlexaClientSDKConfig.json";
 
 const char filePath[30] = "/home/parallels/corpus.txt";
@@ -89,6 +100,330 @@ static const std::string ENDPOINT_KEY("endpoint");
 /// Key for setting if display cards are supported or not under the @c SAMPLE_APP_CONFIG_KEY configuration node.
 static const std::string DISPLAY_CARD_KEY("displayCardsSupported");
 
+/// Environment variable that overrides the log level, e.g. to debug a deployed device without editing its config.
+static const char LOG_LEVEL_ENV[] = "ALEXA_LOG_LEVEL";
+
+/// Key for the log level under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string LOG_LEVEL_KEY("logLevel");
+
+/// Key for the entries per second each log category may write under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string LOG_RATE_KEY("logRatePerSec");
+
+/// Key for the entries a log category may write at once under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string LOG_BURST_KEY("logBurst");
+
+/// The default rate of each log category; 0 means no limit.
+static const int DEFAULT_LOG_RATE = 20;
+
+/// The default burst of each log category.
+static const int DEFAULT_LOG_BURST = 50;
+
+/// Key for whether silence is played at startup to warm up speech playback under the @c SAMPLE_APP_CONFIG_KEY node.
+static const std::string WARM_UP_SPEAK_MEDIA_PLAYER_KEY("warmUpSpeakMediaPlayer");
+
+/// How long the playback warm-up may take before it is stopped.
+static const std::chrono::milliseconds SPEAK_MEDIA_PLAYER_WARM_UP_TIMEOUT = std::chrono::milliseconds(2000);
+
+/// Key for the audio kept before the end of the wake word under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string WAKE_WORD_PREROLL_MS_KEY("wakeWordPrerollMs");
+
+/// Key for the file latency statistics are written to under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string LATENCY_STATS_FILE_KEY("latencyStatsFile");
+
+/// Key for the seconds between latency statistics writes under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string LATENCY_STATS_PERIOD_KEY("latencyStatsPeriodSec");
+
+/// The default time between latency statistics writes.
+static const std::chrono::seconds DEFAULT_LATENCY_STATS_PERIOD = std::chrono::seconds(10);
+
+/// The largest pre-roll that may be configured.
+static const std::chrono::milliseconds MAX_WAKE_WORD_PREROLL = std::chrono::milliseconds(2000);
+
+/// Audio at the old end of the ring buffer that is never handed out, so the writer cannot overrun a new reader.
+static const std::chrono::seconds RING_BUFFER_SAFETY_MARGIN = std::chrono::seconds(1);
+
+/// Key for the keyword table under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string KEYWORD_TABLE_KEY("keywordTable");
+
+/// How long the acknowledgement of a tap or stop waits for the dialog state to change, e.g. if the tap is rejected.
+static const std::chrono::milliseconds KEYWORD_ACK_TIMEOUT = std::chrono::milliseconds(2000);
+
+/// The keyword table used when none is configured; the recognizer reads the same default.
+static const std::string DEFAULT_KEYWORD_TABLE("/home/parallels/keywords.txt");
+
+/// Key for the recognizer's shared-memory audio ring under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string AUDIO_RING_KEY("audioRing");
+
+/// The wake words and their actions, loaded by @c SampleApplication::initialize() and reloaded when edited.
+static std::unique_ptr<KeywordTable> keywordTable;
+
+/// The file @c keywordTable was loaded from.
+static std::string keywordTablePath;
+
+/// What tells one version of a file from another: an edit within the same second changes the nanoseconds or the size,
+/// and an editor that saves by renaming a new file over the old one changes the inode.
+struct FileVersion {
+    /// The inode.
+    ino_t inode;
+    /// The size in bytes.
+    off_t size;
+    /// The modification time, in seconds.
+    time_t mtimeSec;
+    /// The nanoseconds of the modification time.
+    long mtimeNsec;
+
+    bool operator==(const FileVersion& other) const {
+        return inode == other.inode && size == other.size && mtimeSec == other.mtimeSec &&
+            mtimeNsec == other.mtimeNsec;
+    }
+};
+
+/// The version of @c keywordTablePath when @c keywordTable was loaded.
+static FileVersion keywordTableVersion = {};
+
+/**
+ * Gets the version of a file.
+ *
+ * @param path The file.
+ * @return Its version, or all zeros if it does not exist.
+ */
+static FileVersion getFileVersion(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return FileVersion{};
+    }
+    return FileVersion{st.st_ino, st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+}
+
+/**
+ * Reloads @c keywordTable if its file changed since it was loaded, so that keywords the recognizer picked up at run
+ * time have their actions here too. A table that fails to load leaves the current one in use. Only the thread that
+ * receives the recognizer's detections calls this.
+ */
+static void reloadKeywordTableIfChanged() {
+    auto version = getFileVersion(keywordTablePath);
+    if (version == keywordTableVersion) {
+        return;
+    }
+    keywordTableVersion = version;
+    auto table = KeywordTable::create(keywordTablePath, filePath);
+    if (!table) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Keeping the keyword table, reload failed!");
+        return;
+    }
+    keywordTable = std::move(table);
+}
+
+/// Key for what a wake word does to the current output while Alexa is busy, under the @c SAMPLE_APP_CONFIG_KEY node.
+static const std::string BARGE_IN_KEY("bargeIn");
+
+/// Key for the volume the players are turned down to when @c BARGE_IN_KEY is "duck".
+static const std::string BARGE_IN_DUCK_VOLUME_KEY("bargeInDuckVolume");
+
+/// The default duck volume, on the 0 to 100 speaker scale.
+static const int DEFAULT_BARGE_IN_DUCK_VOLUME = 10;
+
+/// Key for the silence after speech that ends a request on the device, under the @c SAMPLE_APP_CONFIG_KEY node.
+static const std::string ENDPOINT_HANGOVER_MS_KEY("endpointHangoverMs");
+
+/// Key for the speech that must be heard before the endpointer ends a request.
+static const std::string ENDPOINT_MIN_SPEECH_MS_KEY("endpointMinSpeechMs");
+
+/// The default hangover; 0 leaves the end of speech to AVS.
+static const int DEFAULT_ENDPOINT_HANGOVER_MS = 700;
+
+/// The default minimum of speech.
+static const int DEFAULT_ENDPOINT_MIN_SPEECH_MS = 300;
+
+/// How far before the end of the wake word the Recognize event starts.
+static std::chrono::milliseconds wakeWordPreroll = std::chrono::milliseconds(0);
+
+/**
+ * Gets the absolute index of the next sample the microphone will write.
+ *
+ * @param stream The shared data stream the microphone writes to.
+ * @return The writer's index, or @c INVALID_INDEX if no reader could be created.
+ */
+static alexaClientSDK::avsCommon::avs::AudioInputStream::Index getWriterIndex(
+    std::shared_ptr<alexaClientSDK::avsCommon::avs::AudioInputStream> stream) {
+    using alexaClientSDK::avsCommon::avs::AudioInputStream;
+
+    auto reader = stream->createReader(AudioInputStream::Reader::Policy::NONBLOCKING);
+    if (!reader || !reader->seek(0, AudioInputStream::Reader::Reference::BEFORE_WRITER)) {
+        return alexaClientSDK::capabilityAgents::aip::AudioInputProcessor::INVALID_INDEX;
+    }
+    auto index = reader->tell();
+    reader->close();
+    return index;
+}
+
+/**
+ * Computes the index the Recognize event starts at. The microphone streams into the shared data stream all the time,
+ * and that stream keeps the last @c AMOUNT_OF_AUDIO_DATA_IN_BUFFER of audio, so the user can keep talking right after
+ * the wake word: the request starts at the end of the wake word, moved back by @c wakeWordPreroll.
+ *
+ * @param writerIndex The current writer index, from @c getWriterIndex().
+ * @param keywordEndIndex The index of the end of the wake word.
+ * @return The index to start streaming from, clamped to the audio still held in the ring buffer.
+ */
+static alexaClientSDK::avsCommon::avs::AudioInputStream::Index getRecognizeBeginIndex(
+    alexaClientSDK::avsCommon::avs::AudioInputStream::Index writerIndex,
+    alexaClientSDK::avsCommon::avs::AudioInputStream::Index keywordEndIndex) {
+    using alexaClientSDK::avsCommon::avs::AudioInputStream;
+
+    const AudioInputStream::Index prerollSamples = SAMPLE_RATE_HZ * wakeWordPreroll.count() / 1000;
+    const AudioInputStream::Index usableSamples =
+        BUFFER_SIZE_IN_SAMPLES - SAMPLE_RATE_HZ * RING_BUFFER_SAFETY_MARGIN.count();
+    const AudioInputStream::Index oldestIndex = writerIndex > usableSamples ? writerIndex - usableSamples : 0;
+
+    if (keywordEndIndex > writerIndex) {
+        keywordEndIndex = writerIndex;
+    }
+    AudioInputStream::Index beginIndex = keywordEndIndex > prerollSamples ? keywordEndIndex - prerollSamples : 0;
+    return std::max(beginIndex, oldestIndex);
+}
+
+/**
+ * Maps a @c CLOCK_MONOTONIC time reported by the recognizer process onto the shared data stream, assuming the
+ * microphone has been writing in real time since then.
+ *
+ * @param writerIndex The current writer index, from @c getWriterIndex().
+ * @param timeNs The monotonic time in nanoseconds.
+ * @return The stream index captured at @c timeNs.
+ */
+static alexaClientSDK::avsCommon::avs::AudioInputStream::Index getIndexAtMonotonicTime(
+    alexaClientSDK::avsCommon::avs::AudioInputStream::Index writerIndex,
+    long long timeNs) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long ageNs = static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec - timeNs;
+    if (ageNs < 0) {
+        return writerIndex;
+    }
+    alexaClientSDK::avsCommon::avs::AudioInputStream::Index ageSamples = ageNs * SAMPLE_RATE_HZ / 1000000000LL;
+    return writerIndex > ageSamples ? writerIndex - ageSamples : 0;
+}
+
+/**
+ * Carries out the action of a detected keyword.
+ *
+ * @param keyword The detected keyword.
+ * @param interactionManager The interaction manager to act on.
+ * @param keywordEndNs The monotonic time at which the keyword ended.
+ * @param beginIndex The index a tap-to-talk interaction starts streaming from, or @c INVALID_INDEX.
+ * @param bargeInHandler Told about each tap before it is made, or @c nullptr.
+ * @param endpointer Told where each tap's audio begins, or @c nullptr.
+ */
+static void performKeywordAction(
+    const KeywordTable::Keyword& keyword,
+    std::shared_ptr<InteractionManager> interactionManager,
+    int64_t keywordEndNs,
+    alexaClientSDK::avsCommon::avs::AudioInputStream::Index beginIndex,
+    std::shared_ptr<BargeInHandler> bargeInHandler,
+    std::shared_ptr<Endpointer> endpointer) {
+    switch (keyword.action) {
+        case KeywordTable::Action::TAP:
+            LatencyStats::instance().markKeyword(keywordEndNs);
+            LatencyStats::instance().recordSinceKeyword(LatencyStats::Stage::KEYWORD_TO_RECEIVE);
+            if (bargeInHandler) {
+                bargeInHandler->onWakeWord(interactionManager);
+            }
+            if (endpointer) {
+                endpointer->setRequestBegin(
+                    alexaClientSDK::capabilityAgents::aip::AudioInputProcessor::INVALID_INDEX == beginIndex
+                        ? Endpointer::INVALID_INDEX
+                        : beginIndex);
+            }
+            interactionManager->tap(beginIndex);
+            return;
+        case KeywordTable::Action::STOP:
+            interactionManager->stop();
+            return;
+        case KeywordTable::Action::VOLUME:
+            interactionManager->adjustVolume(
+                alexaClientSDK::avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED,
+                static_cast<int8_t>(std::max(-100, std::min(keyword.volumeDelta, 100))));
+            return;
+    }
+}
+
+#ifdef KWD_POCKETSPHINX
+/// Key for the Pocketsphinx acoustic model directory under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string POCKETSPHINX_HMM_KEY("pocketsphinxHmm");
+
+/// Key for the Pocketsphinx dictionary under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string POCKETSPHINX_DICT_KEY("pocketsphinxDict");
+
+/// Key for the keyphrase detection threshold under the @c SAMPLE_APP_CONFIG_KEY configuration node.
+static const std::string POCKETSPHINX_THRESHOLD_KEY("pocketsphinxKwsThreshold");
+
+/// The acoustic model used when none is configured.
+static const std::string DEFAULT_POCKETSPHINX_HMM("/usr/share/pocketsphinx/model/en-us/en-us");
+
+/// The dictionary used when none is configured.
+static const std::string DEFAULT_POCKETSPHINX_DICT("/usr/share/pocketsphinx/model/en-us/cmudict-en-us.dict");
+
+/// The keyphrase threshold used when none is configured.
+static const std::string DEFAULT_POCKETSPHINX_THRESHOLD("1e-20");
+
+/**
+ * Carries out the keyword table action whenever the in-process keyword detector hears a keyword. This is the
+ * in-process equivalent of the control channel handoff in @c SampleApplication::run().
+ */
+class TapKeyWordObserver : public alexaClientSDK::avsCommon::sdkInterfaces::KeyWordObserverInterface {
+public:
+    /**
+     * Constructor.
+     *
+     * @param interactionManager The interaction manager to act on for each detection.
+     * @param bargeInHandler Told about each tap before it is made.
+     * @param endpointer Told where each tap's audio begins, or @c nullptr.
+     */
+    TapKeyWordObserver(
+        std::shared_ptr<InteractionManager> interactionManager,
+        std::shared_ptr<BargeInHandler> bargeInHandler,
+        std::shared_ptr<Endpointer> endpointer) :
+            m_interactionManager{interactionManager},
+            m_bargeInHandler{bargeInHandler},
+            m_endpointer{endpointer} {
+    }
+
+    void onKeyWordDetected(
+        std::shared_ptr<alexaClientSDK::avsCommon::avs::AudioInputStream> stream,
+        std::string keyword,
+        alexaClientSDK::avsCommon::avs::AudioInputStream::Index beginIndex,
+        alexaClientSDK::avsCommon::avs::AudioInputStream::Index endIndex) override {
+        ConsolePrinter::simplePrint(keyword);
+        auto entry = keywordTable->find(keyword);
+        if (!entry) {
+            return;
+        }
+        auto writerIndex = getWriterIndex(stream);
+        int64_t keywordEndNs = LatencyStats::nowNs();
+        if (endIndex < writerIndex) {
+            keywordEndNs -= static_cast<int64_t>(writerIndex - endIndex) * 1000000000LL / SAMPLE_RATE_HZ;
+        }
+        auto beginIndex = alexaClientSDK::capabilityAgents::aip::AudioInputProcessor::INVALID_INDEX;
+        if (alexaClientSDK::capabilityAgents::aip::AudioInputProcessor::INVALID_INDEX != writerIndex &&
+            alexaClientSDK::avsCommon::sdkInterfaces::KeyWordObserverInterface::UNSPECIFIED_INDEX != endIndex) {
+            beginIndex = getRecognizeBeginIndex(writerIndex, endIndex);
+        }
+        performKeywordAction(
+            *entry, m_interactionManager, keywordEndNs, beginIndex, m_bargeInHandler, m_endpointer);
+    }
+
+private:
+    /// The interaction manager to tap on each detection.
+    std::shared_ptr<InteractionManager> m_interactionManager;
+
+    /// Told about each tap before it is made.
+    std::shared_ptr<BargeInHandler> m_bargeInHandler;
+
+    /// Told where each tap's audio begins, or @c nullptr.
+    std::shared_ptr<Endpointer> m_endpointer;
+};
+#endif
+
 /// A set of all log levels.
 static const std::set<alexaClientSDK::avsCommon::utils::logger::Level> allLevels = {
     alexaClientSDK::avsCommon::utils::logger::Level::DEBUG9,
@@ -118,6 +453,27 @@ static alexaClientSDK::avsCommon::utils::logger::Level getLogLevelFromUserInput(
     return alexaClientSDK::avsCommon::utils::logger::convertNameToLevel(userInputLogLevel);
 }
 
+/**
+ * Prints the log level the app runs with, or the valid levels if @c userInputLogLevel is not one of them.
+ *
+ * @param userInputLogLevel The log level asked for.
+ * @return Whether @c userInputLogLevel is a valid level.
+ */
+static bool printLogLevelIfValid(const std::string& userInputLogLevel) {
+    auto logLevelValue = getLogLevelFromUserInput(userInputLogLevel);
+    if (alexaClientSDK::avsCommon::utils::logger::Level::UNKNOWN == logLevelValue) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Unknown log level input!");
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Possible log level options are: ");
+        for (auto it = allLevels.begin(); it != allLevels.end(); ++it) {
+                alexaClientSDK::sampleApp::ConsolePrinter::simplePrint(
+                alexaClientSDK::avsCommon::utils::logger::convertLevelToName(*it));
+        }
+        return false;
+    }
+    alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Running app with log level: " + alexaClientSDK::avsCommon::utils::logger::convertLevelToName(logLevelValue));
+    return true;
+}
+
 std::unique_ptr<SampleApplication> SampleApplication::create() {
     auto clientApplication = std::unique_ptr<SampleApplication>(new SampleApplication);
 
@@ -128,83 +484,100 @@ std::unique_ptr<SampleApplication> SampleApplication::create() {
     return clientApplication;
 }
 
+SampleApplication::~SampleApplication() {
+#ifdef KWD_POCKETSPHINX
+    // Its thread taps the interaction manager.
+    m_keywordDetector.reset();
+#endif
+    if (client) {
+        if (m_endpointer) {
+            client->removeAlexaDialogStateObserver(m_endpointer);
+        }
+        if (m_bargeInHandler) {
+            client->removeAlexaDialogStateObserver(m_bargeInHandler);
+        }
+    }
+    // Each joins its thread, which calls into the client or writes its stream.
+    m_endpointer.reset();
+    m_bargeInHandler.reset();
+    m_shmAudioSource.reset();
+}
+
 void SampleApplication::run() {
     // 2018/05/04 Bling Added
     if (!interactionManager) {
         return;
     }
-    
-    struct my_msgbuf buf;
-    int msqid;
-    key_t key;
-
-    if ((key = ftok(filePath, 66)) == -1) {
-        perror("ftok");
-        return;
-    }
-
-    if ((msqid = msgget(key, 0644 | IPC_CREAT)) == -1) {
-        perror("msgget");
-        return;
-    }
-
-    if ((saFile = fopen(filePath, "r")) == NULL) {
-        perror("fopen");
-        return;
-    }
-
-    while (fgets(saBuffer, 20, saFile) != NULL) {
-    }
-    fclose(saFile);
 
+#ifdef KWD_POCKETSPHINX
+    /*
+     * The keyword detector taps the interaction manager from its own thread, so there is nothing left to do here but
+     * keep the application alive.
+     */
     while (true) {
-        if (msgrcv(msqid, &buf, sizeof(buf), 0, 0) == -1) {
-            perror("msgrcv");
-            return;
-        }
-
-        if (!strncmp(buf.mtext, saBuffer, strlen(saBuffer) - 1)) {
-            printf("%s\n", buf.mtext);
-            // reset shared_ptr
-            reSampleApplication();
-            // get device microphone to use
-            if (paMicrophone()) {
-                interactionManager->tap();
+        pause();
+    }
+#endif
+
+    auto& controlChannel = ControlChannel::instance();
+    ControlChannel::Keyword received;
+
+    while (controlChannel.receiveKeyword(&received)) {
+        reloadKeywordTableIfChanged();
+        auto keyword = keywordTable->find(received.phrase);
+        if (keyword) {
+            printf("%s\n", received.phrase.c_str());
+            if (received.doaDegrees >= 0) {
+                printf("direction: %d degrees\n", received.doaDegrees);
+            }
+            /*
+             * The shared data stream, microphone and interaction manager built by paMicrophone() live for the
+             * whole session: the microphone keeps streaming into the ring buffer, so the request can start at the
+             * end of the wake word without rebuilding anything.
+             */
+            auto writerIndex = getWriterIndex(sharedDataStream);
+            auto beginIndex = alexaClientSDK::capabilityAgents::aip::AudioInputProcessor::INVALID_INDEX;
+            if (alexaClientSDK::capabilityAgents::aip::AudioInputProcessor::INVALID_INDEX != writerIndex) {
+                beginIndex = getRecognizeBeginIndex(
+                    writerIndex, getIndexAtMonotonicTime(writerIndex, received.keywordEndNs));
+            }
+            performKeywordAction(
+                *keyword, interactionManager, received.keywordEndNs, beginIndex, m_bargeInHandler, m_endpointer);
+            /*
+             * A tap or stop changes the dialog state later, on the interaction manager's executor. The recognizer
+             * stays gated until the acknowledgement arrives, so it goes out with that change rather than now, while
+             * the state is still the one the keyword was heard in. A tap is acknowledged with LISTENING, since one
+             * that barges in passes through IDLE first.
+             */
+            if (KeywordTable::Action::TAP == keyword->action) {
+                controlChannel.acknowledgeOnState(received.seq, ControlChannel::State::LISTENING, KEYWORD_ACK_TIMEOUT);
+                continue;
+            }
+            if (KeywordTable::Action::STOP == keyword->action) {
+                controlChannel.acknowledgeOnStateChange(received.seq, KEYWORD_ACK_TIMEOUT);
+                continue;
             }
         }
+        controlChannel.acknowledge(received.seq);
     }
     // 2018/05/04 Bling Added
 }
 
-void SampleApplication::reSampleApplication() {
-    sharedDataStream.reset();
-    micWrapper.reset();
-    interactionManager.reset();
-}
-
 bool SampleApplication::initialize() {
+    int64_t bootNs = LatencyStats::nowNs();
+
     /*
-     * Set up the SDK logging system to write to the SampleApp's ConsolePrinter.  Also adjust the logging level
-     * if requested.
+     * Set up the SDK logging system to write to the console through the asynchronous logger, so that logging never
+     * waits for the console on an SDK thread. The level is taken from LOG_LEVEL_ENV if set, and otherwise from the
+     * configuration once it has been read.
      */
-    std::shared_ptr<alexaClientSDK::avsCommon::utils::logger::Logger> consolePrinter =
-        std::make_shared<alexaClientSDK::sampleApp::ConsolePrinter>();
-
-    auto logLevelValue = getLogLevelFromUserInput(logLevel);
-    if (alexaClientSDK::avsCommon::utils::logger::Level::UNKNOWN == logLevelValue) {
-        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Unknown log level input!");
-        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Possible log level options are: ");
-        for (auto it = allLevels.begin(); it != allLevels.end(); ++it) {
-                alexaClientSDK::sampleApp::ConsolePrinter::simplePrint(
-                alexaClientSDK::avsCommon::utils::logger::convertLevelToName(*it));
-        }
+    const char* envLogLevel = getenv(LOG_LEVEL_ENV);
+    if (!printLogLevelIfValid(envLogLevel ? envLogLevel : logLevel)) {
         return false;
     }
+    auto asyncLogger = AsyncLogger::create(getLogLevelFromUserInput(envLogLevel ? envLogLevel : logLevel));
 
-    alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Running app with log level: " + alexaClientSDK::avsCommon::utils::logger::convertLevelToName(logLevelValue));
-    consolePrinter->setLevel(logLevelValue);
-
-    alexaClientSDK::avsCommon::utils::logger::LoggerSinkManager::instance().initialize(consolePrinter);
+    alexaClientSDK::avsCommon::utils::logger::LoggerSinkManager::instance().initialize(asyncLogger);
 
     /*
      * This is a required step upon startup of the SDK before any modules are created. For that reason, it is being
@@ -223,36 +596,174 @@ bool SampleApplication::initialize() {
     auto config = alexaClientSDK::avsCommon::utils::configuration::ConfigurationNode::getRoot();
     auto sampleAppConfig = config[SAMPLE_APP_CONFIG_KEY];
 
+    std::string configLogLevel;
+    if (!envLogLevel && sampleAppConfig.getString(LOG_LEVEL_KEY, &configLogLevel) &&
+        printLogLevelIfValid(configLogLevel)) {
+        asyncLogger->setLevel(getLogLevelFromUserInput(configLogLevel));
+    }
+    int logRate = DEFAULT_LOG_RATE;
+    int logBurst = DEFAULT_LOG_BURST;
+    sampleAppConfig.getInt(LOG_RATE_KEY, &logRate, logRate);
+    sampleAppConfig.getInt(LOG_BURST_KEY, &logBurst, logBurst);
+    asyncLogger->setRateLimit(std::max(logRate, 0), std::max(logBurst, 1));
+
+    int prerollMs = static_cast<int>(wakeWordPreroll.count());
+    sampleAppConfig.getInt(WAKE_WORD_PREROLL_MS_KEY, &prerollMs, prerollMs);
+    wakeWordPreroll = std::min(std::chrono::milliseconds(std::max(prerollMs, 0)), MAX_WAKE_WORD_PREROLL);
+
+    std::string latencyStatsFile;
+    int latencyStatsPeriod = static_cast<int>(DEFAULT_LATENCY_STATS_PERIOD.count());
+    sampleAppConfig.getString(LATENCY_STATS_FILE_KEY, &latencyStatsFile);
+    sampleAppConfig.getInt(LATENCY_STATS_PERIOD_KEY, &latencyStatsPeriod, latencyStatsPeriod);
+    LatencyStats::instance().startDumping(latencyStatsFile, std::chrono::seconds(std::max(latencyStatsPeriod, 1)));
+
+    sampleAppConfig.getString(KEYWORD_TABLE_KEY, &keywordTablePath, DEFAULT_KEYWORD_TABLE);
+    keywordTableVersion = getFileVersion(keywordTablePath);
+    keywordTable = KeywordTable::create(keywordTablePath, filePath);
+    if (!keywordTable) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to load keyword table!");
+        return false;
+    }
+
     auto httpContentFetcherFactory = std::make_shared<avsCommon::utils::libcurlUtils::HTTPContentFetcherFactory>();
 
+    compatibleAudioFormat.sampleRateHz = SAMPLE_RATE_HZ;
+    compatibleAudioFormat.sampleSizeInBits = WORD_SIZE * CHAR_BIT;
+    compatibleAudioFormat.numChannels = NUM_CHANNELS;
+    compatibleAudioFormat.endianness = alexaClientSDK::avsCommon::utils::AudioFormat::Endianness::LITTLE;
+    compatibleAudioFormat.encoding = alexaClientSDK::avsCommon::utils::AudioFormat::Encoding::LPCM;
+
+    /*
+     * Startup is a small dependency graph. The media players, the AuthDelegate and the microphone do not depend on
+     * each other, so each is created on its own thread. The storages only open their databases when the DefaultClient
+     * starts, so they are built inline. The DefaultClient needs all but the microphone, and the wake word is armed
+     * on top of the client before waiting for authorization and connection. A future left unread when returning
+     * early is waited for by its destructor.
+     */
+    auto openMicrophone = [&]() -> bool {
+        /*
+         * Creating the buffer (Shared Data Stream) that will hold user audio data. This is the main input into the
+         * SDK.
+         */
+        size_t bufferSize = alexaClientSDK::avsCommon::avs::AudioInputStream::calculateBufferSize(
+            BUFFER_SIZE_IN_SAMPLES, WORD_SIZE, MAX_READERS);
+        auto buffer = std::make_shared<alexaClientSDK::avsCommon::avs::AudioInputStream::Buffer>(bufferSize);
+
+        sharedDataStream = alexaClientSDK::avsCommon::avs::AudioInputStream::create(buffer, WORD_SIZE, MAX_READERS);
+        if (!sharedDataStream) {
+            alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create shared data stream!");
+            return false;
+        }
+
+        /*
+         * With the recognizer publishing its capture in a shared-memory ring, the SampleApp does not open the
+         * microphone at all; otherwise PortAudio records into the stream. Exactly one of the two writes to the stream.
+         */
+        std::string audioRing;
+        sampleAppConfig.getString(AUDIO_RING_KEY, &audioRing);
+        if (!audioRing.empty()) {
+            m_shmAudioSource = alexaClientSDK::sampleApp::ShmAudioSource::create(audioRing, sharedDataStream);
+            if (!m_shmAudioSource) {
+                alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to map audio ring " + audioRing + "!");
+                return false;
+            }
+            m_shmAudioSource->startStreamingMicrophoneData();
+        } else {
+            micWrapper = alexaClientSDK::sampleApp::PortAudioMicrophoneWrapper::create(sharedDataStream);
+            if (!micWrapper) {
+                alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create PortAudioMicrophoneWrapper!");
+                return false;
+            }
+        }
+        return true;
+    };
+    auto microphoneFuture = std::async(std::launch::async, openMicrophone);
+
     /*
      * Creating the media players. Here, the default GStreamer based MediaPlayer is being created. However, any
      * MediaPlayer that follows the specified MediaPlayerInterface can work.
      */
-    m_speakMediaPlayer = alexaClientSDK::mediaPlayer::MediaPlayer::create(httpContentFetcherFactory, avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED, "SpeakMediaPlayer");
+    auto createMediaPlayer = [httpContentFetcherFactory](
+                                 avsCommon::sdkInterfaces::SpeakerInterface::Type type, std::string name) {
+        return std::async(std::launch::async, [httpContentFetcherFactory, type, name] {
+            return alexaClientSDK::mediaPlayer::MediaPlayer::create(httpContentFetcherFactory, type, name);
+        });
+    };
+    auto speakMediaPlayerFuture =
+        createMediaPlayer(avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED, "SpeakMediaPlayer");
+    auto audioMediaPlayerFuture =
+        createMediaPlayer(avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED, "AudioMediaPlayer");
+    auto notificationsMediaPlayerFuture =
+        createMediaPlayer(avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED, "NotificationsMediaPlayer");
+    /*
+     * The ALERTS speaker type will cause volume control to be independent and localized. By assigning this type,
+     * Alerts volume/mute changes will not be in sync with AVS. No directives or events will be associated with volume
+     * control.
+     */
+    auto alertsMediaPlayerFuture =
+        createMediaPlayer(avsCommon::sdkInterfaces::SpeakerInterface::Type::LOCAL, "AlertsMediaPlayer");
+
+    /*
+     * The first playback of the process loads the GStreamer plugins, which otherwise delays the first reply. The
+     * warm-up plays through a player of its own, so neither the SDK's players nor startup wait for it; it is only
+     * waited for once the client is connected, before which no reply can arrive.
+     */
+    bool warmUpSpeakMediaPlayer;
+    sampleAppConfig.getBool(WARM_UP_SPEAK_MEDIA_PLAYER_KEY, &warmUpSpeakMediaPlayer, true);
+    std::future<bool> warmUpFuture;
+    if (warmUpSpeakMediaPlayer) {
+        warmUpFuture = std::async(std::launch::async, [httpContentFetcherFactory] {
+            auto player = alexaClientSDK::mediaPlayer::MediaPlayer::create(
+                httpContentFetcherFactory,
+                avsCommon::sdkInterfaces::SpeakerInterface::Type::LOCAL,
+                "WarmUpMediaPlayer");
+            return player && MediaPlayerWarmer::warm(player, SPEAK_MEDIA_PLAYER_WARM_UP_TIMEOUT);
+        });
+    }
+
+    auto audioFactory = std::make_shared<alexaClientSDK::applicationUtilities::resources::audio::AudioFactory>();
+
+    // Creating the alert storage object to be used for rendering and storing alerts.
+    auto alertStorage =
+        std::make_shared<alexaClientSDK::capabilityAgents::alerts::storage::SQLiteAlertStorage>(audioFactory->alerts());
+
+    /*
+     * Creating notifications storage object to be used for storing notification indicators.
+     */
+    auto notificationsStorage =
+        std::make_shared<alexaClientSDK::capabilityAgents::notifications::SQLiteNotificationsStorage>();
+
+    /*
+     * Creating settings storage object to be used for storing <key, value> pairs of AVS Settings.
+     */
+    auto settingsStorage = std::make_shared<alexaClientSDK::capabilityAgents::settings::SQLiteSettingStorage>();
+
+    /*
+     * Creating the AuthDelegate - this component takes care of LWA and authorization of the client. At the moment,
+     * this must be done and authorization must be achieved prior to making the call to connect().
+     */
+    auto authDelegateFuture =
+        std::async(std::launch::async, [] { return alexaClientSDK::authDelegate::AuthDelegate::create(); });
+
+    m_speakMediaPlayer = speakMediaPlayerFuture.get();
     if (!m_speakMediaPlayer) {
         alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create media player for speech!");
         return false;
     }
 
-    m_audioMediaPlayer = alexaClientSDK::mediaPlayer::MediaPlayer::create(httpContentFetcherFactory, avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED, "AudioMediaPlayer");
+    m_audioMediaPlayer = audioMediaPlayerFuture.get();
     if (!m_audioMediaPlayer) {
         alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create media player for content!");
         return false;
     }
 
-    m_notificationsMediaPlayer = alexaClientSDK::mediaPlayer::MediaPlayer::create(httpContentFetcherFactory, avsCommon::sdkInterfaces::SpeakerInterface::Type::AVS_SYNCED, "NotificationsMediaPlayer");
+    m_notificationsMediaPlayer = notificationsMediaPlayerFuture.get();
     if (!m_notificationsMediaPlayer) {
         alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create media player for notifications!");
         return false;
     }
 
-    /*
-     * The ALERTS speaker type will cause volume control to be independent and localized. By assigning this type,
-     * Alerts volume/mute changes will not be in sync with AVS. No directives or events will be associated with volume
-     * control.
-     */
-    m_alertsMediaPlayer = alexaClientSDK::mediaPlayer::MediaPlayer::create(httpContentFetcherFactory, avsCommon::sdkInterfaces::SpeakerInterface::Type::LOCAL, "AlertsMediaPlayer");
+    m_alertsMediaPlayer = alertsMediaPlayerFuture.get();
     if (!m_alertsMediaPlayer) {
         alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create media player for alerts!");
         return false;
@@ -267,20 +778,15 @@ bool SampleApplication::initialize() {
     std::shared_ptr<alexaClientSDK::avsCommon::sdkInterfaces::SpeakerInterface> alertsSpeaker = std::static_pointer_cast<alexaClientSDK::avsCommon::sdkInterfaces::SpeakerInterface>(m_alertsMediaPlayer);
     std::shared_ptr<alexaClientSDK::avsCommon::sdkInterfaces::SpeakerInterface> notificationsSpeaker = std::static_pointer_cast<alexaClientSDK::avsCommon::sdkInterfaces::SpeakerInterface>(m_notificationsMediaPlayer);
 
-    auto audioFactory = std::make_shared<alexaClientSDK::applicationUtilities::resources::audio::AudioFactory>();
-
-    // Creating the alert storage object to be used for rendering and storing alerts.
-    auto alertStorage = std::make_shared<alexaClientSDK::capabilityAgents::alerts::storage::SQLiteAlertStorage>(audioFactory->alerts());
-
-    /*
-     * Creating notifications storage object to be used for storing notification indicators.
-     */
-    auto notificationsStorage = std::make_shared<alexaClientSDK::capabilityAgents::notifications::SQLiteNotificationsStorage>();
-
-    /*
-     * Creating settings storage object to be used for storing <key, value> pairs of AVS Settings.
-     */
-    auto settingsStorage = std::make_shared<alexaClientSDK::capabilityAgents::settings::SQLiteSettingStorage>();
+    std::string bargeInMode;
+    int duckVolume = DEFAULT_BARGE_IN_DUCK_VOLUME;
+    BargeInHandler::Mode mode;
+    sampleAppConfig.getString(BARGE_IN_KEY, &bargeInMode, "stop");
+    sampleAppConfig.getInt(BARGE_IN_DUCK_VOLUME_KEY, &duckVolume, duckVolume);
+    if (!BargeInHandler::parseMode(bargeInMode, &mode)) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Invalid bargeIn, expected none, stop or duck!");
+        return false;
+    }
 
     /*
      * Creating the UI component that observes various components and prints to the console accordingly.
@@ -294,11 +800,11 @@ bool SampleApplication::initialize() {
      */
     auto connectionObserver = std::make_shared<alexaClientSDK::sampleApp::ConnectionObserver>();
 
-    /*
-     * Creating the AuthDelegate - this component takes care of LWA and authorization of the client. At the moment,
-     * this must be done and authorization must be achieved prior to making the call to connect().
-     */
-    std::shared_ptr<alexaClientSDK::authDelegate::AuthDelegate> authDelegate = alexaClientSDK::authDelegate::AuthDelegate::create();
+    std::shared_ptr<alexaClientSDK::authDelegate::AuthDelegate> authDelegate = authDelegateFuture.get();
+    if (!authDelegate) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create AuthDelegate!");
+        return false;
+    }
 
     authDelegate->addAuthObserver(connectionObserver);
 
@@ -336,6 +842,14 @@ bool SampleApplication::initialize() {
         return false;
     }
 
+    m_bargeInHandler = std::make_shared<BargeInHandler>(
+        mode, static_cast<int8_t>(std::max(0, std::min(duckVolume, 100))), client->getSpeakerManager());
+
+    // The wake word only needs the client object, not a connection, so it is armed while LWA and AVS are reached.
+    if (!microphoneFuture.get() || !paMicrophone()) {
+        return false;
+    }
+
     /*
      * TODO: ACSDK-384 Remove the requirement of clients having to wait for authorization before making the connect()
      * call.
@@ -364,6 +878,8 @@ bool SampleApplication::initialize() {
 
     client->addNotificationsObserver(userInterfaceManager);
 
+    client->addAlexaDialogStateObserver(m_bargeInHandler);
+
     /*
      * Add GUI Renderer as an observer if display cards are supported.  The default is supported unless specified
      * otherwise in the configuration.
@@ -375,14 +891,14 @@ bool SampleApplication::initialize() {
         client->addTemplateRuntimeObserver(guiRenderer);
     }
 
-    compatibleAudioFormat.sampleRateHz = SAMPLE_RATE_HZ;
-    compatibleAudioFormat.sampleSizeInBits = WORD_SIZE * CHAR_BIT;
-    compatibleAudioFormat.numChannels = NUM_CHANNELS;
-    compatibleAudioFormat.endianness = alexaClientSDK::avsCommon::utils::AudioFormat::Endianness::LITTLE;
-    compatibleAudioFormat.encoding = alexaClientSDK::avsCommon::utils::AudioFormat::Encoding::LPCM;
+    int64_t bootToListeningNs = LatencyStats::nowNs() - bootNs;
+    LatencyStats::instance().record(LatencyStats::Stage::BOOT_TO_LISTENING, bootToListeningNs);
+    alexaClientSDK::sampleApp::ConsolePrinter::simplePrint(
+        "Listening for the wake word " + std::to_string(bootToListeningNs / 1000000) + " ms after startup");
 
-    if (!paMicrophone()) {
-        return false;
+    // Usually long done by now; its own duration is logged as MediaPlayerWarmer:warmed.
+    if (warmUpFuture.valid()) {
+        warmUpFuture.get();
     }
 
     return true;
@@ -390,18 +906,8 @@ bool SampleApplication::initialize() {
 
 bool SampleApplication::paMicrophone() {
     /*
-     * Creating the buffer (Shared Data Stream) that will hold user audio data. This is the main input into the SDK.
-     */
-    size_t bufferSize = alexaClientSDK::avsCommon::avs::AudioInputStream::calculateBufferSize(BUFFER_SIZE_IN_SAMPLES, WORD_SIZE, MAX_READERS);
-    auto buffer = std::make_shared<alexaClientSDK::avsCommon::avs::AudioInputStream::Buffer>(bufferSize);
-
-    sharedDataStream = alexaClientSDK::avsCommon::avs::AudioInputStream::create(buffer, WORD_SIZE, MAX_READERS);
-    if (!sharedDataStream) {
-        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create shared data stream!");
-        return false;
-    }
-
-    /*
+     * The shared data stream and its writer were created by initialize() while the rest of the SDK was starting.
+     *
      * Creating each of the audio providers. An audio provider is a simple package of data consisting of the stream
      * of audio data, as well as metadata about the stream. For each of the three audio providers created here, the same
      * stream is used since this sample application will only have one microphone.
@@ -433,14 +939,88 @@ bool SampleApplication::paMicrophone() {
         holdCanOverride,
         holdCanBeOverridden);
 
-    micWrapper = alexaClientSDK::sampleApp::PortAudioMicrophoneWrapper::create(sharedDataStream);
-    if (!micWrapper) {
-        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create PortAudioMicrophoneWrapper!");
+    /*
+     * Every request starts with a tap, so without an endpoint the upload runs until AVS detects the trailing
+     * silence. The endpointer ends it from here instead, like a second tap would.
+     */
+    int hangoverMs;
+    int minSpeechMs;
+    auto endpointConfig =
+        alexaClientSDK::avsCommon::utils::configuration::ConfigurationNode::getRoot()[SAMPLE_APP_CONFIG_KEY];
+    endpointConfig.getInt(ENDPOINT_HANGOVER_MS_KEY, &hangoverMs, DEFAULT_ENDPOINT_HANGOVER_MS);
+    endpointConfig.getInt(ENDPOINT_MIN_SPEECH_MS_KEY, &minSpeechMs, DEFAULT_ENDPOINT_MIN_SPEECH_MS);
+    if (hangoverMs > 0) {
+        // The destructor stops the endpointer before the client goes, so the callback never outlives it.
+        m_endpointer = alexaClientSDK::sampleApp::Endpointer::create(
+            sharedDataStream,
+            std::chrono::milliseconds(hangoverMs),
+            std::chrono::milliseconds(std::max(minSpeechMs, 0)),
+            [this] { client->notifyOfTapToTalkEnd(); });
+        if (!m_endpointer) {
+            alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create Endpointer!");
+            return false;
+        }
+        client->addAlexaDialogStateObserver(m_endpointer);
+    }
+
+#ifdef KWD_POCKETSPHINX
+    // Creating wake word audio provider, if necessary
+    bool wakeAlwaysReadable = true;
+    bool wakeCanOverride = false;
+    bool wakeCanBeOverridden = true;
+
+    alexaClientSDK::capabilityAgents::aip::AudioProvider wakeWordAudioProvider(
+        sharedDataStream,
+        compatibleAudioFormat,
+        alexaClientSDK::capabilityAgents::aip::ASRProfile::NEAR_FIELD,
+        wakeAlwaysReadable,
+        wakeCanOverride,
+        wakeCanBeOverridden);
+
+    interactionManager = std::make_shared<alexaClientSDK::sampleApp::InteractionManager>(client, micWrapper, userInterfaceManager, holdToTalkAudioProvider, tapToTalkAudioProvider, wakeWordAudioProvider);
+    client->addAlexaDialogStateObserver(interactionManager);
+
+    auto sampleAppConfig = alexaClientSDK::avsCommon::utils::configuration::ConfigurationNode::getRoot()[SAMPLE_APP_CONFIG_KEY];
+    std::string hmmPath;
+    std::string dictPath;
+    std::string threshold;
+    sampleAppConfig.getString(POCKETSPHINX_HMM_KEY, &hmmPath, DEFAULT_POCKETSPHINX_HMM);
+    sampleAppConfig.getString(POCKETSPHINX_DICT_KEY, &dictPath, DEFAULT_POCKETSPHINX_DICT);
+    sampleAppConfig.getString(POCKETSPHINX_THRESHOLD_KEY, &threshold, DEFAULT_POCKETSPHINX_THRESHOLD);
+
+    // The decoder only reads keyword files, and keeps nothing from it after ps_init().
+    char kwsPath[] = "/tmp/sampleapp-kws-XXXXXX";
+    int kwsFd = mkstemp(kwsPath);
+    if (kwsFd < 0) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create keyword file!");
+        return false;
+    }
+    close(kwsFd);
+    if (!keywordTable->writeKwsFile(kwsPath, std::stod(threshold))) {
+        unlink(kwsPath);
         return false;
     }
 
+    // This observer is notified any time a keyword is detected and carries out its action.
+    auto keywordObserver = std::make_shared<TapKeyWordObserver>(interactionManager, m_bargeInHandler, m_endpointer);
+
+    m_keywordDetector = alexaClientSDK::sampleApp::PocketsphinxKeywordDetector::create(
+        sharedDataStream,
+        compatibleAudioFormat,
+        {keywordObserver},
+        std::unordered_set<std::shared_ptr<alexaClientSDK::avsCommon::sdkInterfaces::KeyWordDetectorStateObserverInterface>>(),
+        hmmPath,
+        dictPath,
+        kwsPath);
+    unlink(kwsPath);
+    if (!m_keywordDetector) {
+        alexaClientSDK::sampleApp::ConsolePrinter::simplePrint("Failed to create PocketsphinxKeywordDetector!");
+        return false;
+    }
+#else
     interactionManager = std::make_shared<alexaClientSDK::sampleApp::InteractionManager>(client, micWrapper, userInterfaceManager, holdToTalkAudioProvider, tapToTalkAudioProvider);
     client->addAlexaDialogStateObserver(interactionManager);
+#endif
 
     return true;
 }
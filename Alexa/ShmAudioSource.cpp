@@ -0,0 +1,241 @@
+/*
+ * ShmAudioSource.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/ShmAudioSource.h"
+#include "audioring.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+using avsCommon::avs::AudioInputStream;
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("ShmAudioSource");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// The only sample rate the stream is set up for.
+static const uint32_t COMPATIBLE_SAMPLE_RATE = 16000;
+
+/// How long the reader sleeps on the futex before rechecking for shutdown.
+static const int WAIT_TIMEOUT_MS = 100;
+
+/// How long the ring may stay quiet before the reader checks whether the recognizer has replaced it.
+static const std::chrono::seconds STALE_TIMEOUT{1};
+
+/**
+ * Maps the ring @c name read-only and checks its header.
+ *
+ * @param name The POSIX shared-memory object.
+ * @param event The event to log failures under.
+ * @param[out] inode The inode of the object that was mapped.
+ * @return The mapped ring, or @c nullptr.
+ */
+static audio_ring_t* mapRing(const std::string& name, const std::string& event, ino_t* inode) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        ACSDK_ERROR(LX(event).d("reason", "shmOpenFailed").d("name", name));
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(audio_ring_t)) {
+        ACSDK_ERROR(LX(event).d("reason", "ringTooSmall").d("name", name));
+        close(fd);
+        return nullptr;
+    }
+    // Read-only: the futex wait only reads the word, and nothing here may disturb the recognizer.
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) {
+        ACSDK_ERROR(LX(event).d("reason", "mmapFailed").d("name", name));
+        return nullptr;
+    }
+
+    auto ring = static_cast<audio_ring_t*>(map);
+    if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != AUDIO_RING_MAGIC ||
+        ring->version != AUDIO_RING_VERSION || ring->capacity == 0 || ring->frame == 0 ||
+        ring->frame >= ring->capacity || ring->capacity % ring->frame != 0 ||
+        audio_ring_bytes(ring->capacity) > static_cast<size_t>(st.st_size)) {
+        ACSDK_ERROR(LX(event).d("reason", "invalidRing").d("name", name));
+        munmap(map, st.st_size);
+        return nullptr;
+    }
+    if (ring->samprate != COMPATIBLE_SAMPLE_RATE) {
+        ACSDK_ERROR(LX(event).d("reason", "unsupportedSampleRate").d("sampleRate", ring->samprate));
+        munmap(map, st.st_size);
+        return nullptr;
+    }
+    *inode = st.st_ino;
+    return ring;
+}
+
+std::unique_ptr<ShmAudioSource> ShmAudioSource::create(
+    const std::string& name,
+    std::shared_ptr<AudioInputStream> stream) {
+    if (!stream) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "nullStream"));
+        return nullptr;
+    }
+
+    ino_t inode;
+    auto ring = mapRing(name, "createFailed", &inode);
+    if (!ring) {
+        return nullptr;
+    }
+
+    std::shared_ptr<AudioInputStream::Writer> writer =
+        stream->createWriter(AudioInputStream::Writer::Policy::NONBLOCKABLE);
+    if (!writer) {
+        ACSDK_ERROR(LX("createFailed").d("reason", "createWriterFailed"));
+        munmap(ring, audio_ring_bytes(ring->capacity));
+        return nullptr;
+    }
+
+    return std::unique_ptr<ShmAudioSource>(new ShmAudioSource(name, stream, writer, ring, inode));
+}
+
+ShmAudioSource::ShmAudioSource(
+    const std::string& name,
+    std::shared_ptr<AudioInputStream> stream,
+    std::shared_ptr<AudioInputStream::Writer> writer,
+    audio_ring_s* ring,
+    ino_t inode) :
+        m_name{name},
+        m_stream{stream},
+        m_writer{writer},
+        m_ring{ring},
+        m_inode{inode},
+        m_isStreaming{false},
+        m_isShuttingDown{false} {
+    m_readThread = std::thread(&ShmAudioSource::readLoop, this);
+}
+
+ShmAudioSource::~ShmAudioSource() {
+    m_isShuttingDown = true;
+    if (m_readThread.joinable()) {
+        m_readThread.join();
+    }
+    m_writer->close();
+    munmap(m_ring, audio_ring_bytes(m_ring->capacity));
+}
+
+bool ShmAudioSource::startStreamingMicrophoneData() {
+    m_isStreaming = true;
+    return true;
+}
+
+bool ShmAudioSource::stopStreamingMicrophoneData() {
+    m_isStreaming = false;
+    return true;
+}
+
+bool ShmAudioSource::remapIfReplaced() {
+    int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    bool isReplaced = fstat(fd, &st) == 0 && st.st_ino != m_inode;
+    close(fd);
+    if (!isReplaced) {
+        return false;
+    }
+
+    ino_t inode;
+    auto ring = mapRing(m_name, "remapFailed", &inode);
+    if (!ring) {
+        return false;
+    }
+    munmap(m_ring, audio_ring_bytes(m_ring->capacity));
+    m_ring = ring;
+    m_inode = inode;
+    ACSDK_INFO(LX("ringRemapped").d("name", m_name));
+    return true;
+}
+
+void ShmAudioSource::readLoop() {
+    uint64_t readPos = audio_ring_write_pos(m_ring);
+    auto lastWrite = std::chrono::steady_clock::now();
+
+    while (!m_isShuttingDown) {
+        const int16_t* samples = audio_ring_samples(m_ring);
+        const uint64_t capacity = m_ring->capacity;
+        // The writer fills [write_pos, write_pos + frame) before it commits, so only the rest of the ring is stable.
+        const uint64_t limit = capacity - m_ring->frame;
+        uint32_t seq = audio_ring_seq(m_ring);
+        uint64_t writePos = audio_ring_write_pos(m_ring);
+        auto now = std::chrono::steady_clock::now();
+        if (writePos == readPos) {
+            // A restarted recognizer creates a new ring under the same name and leaves this one silent.
+            if (now - lastWrite >= STALE_TIMEOUT) {
+                lastWrite = now;
+                if (remapIfReplaced()) {
+                    readPos = audio_ring_write_pos(m_ring);
+                }
+                continue;
+            }
+            audio_ring_wait(m_ring, seq, WAIT_TIMEOUT_MS);
+            continue;
+        }
+        lastWrite = now;
+        if (writePos - readPos > limit) {
+            // The oldest unread frame is being overwritten; skip to the newest audio.
+            ACSDK_WARN(LX("readLoop").d("reason", "ringOverrun").d("lostSamples", writePos - readPos));
+            readPos = writePos;
+            continue;
+        }
+        if (!m_isStreaming) {
+            readPos = writePos;
+            continue;
+        }
+
+        // At most two writes: up to the end of the ring, then from its start.
+        uint64_t startPos = readPos;
+        while (readPos < writePos) {
+            uint64_t offset = readPos % capacity;
+            uint64_t count = std::min(writePos - readPos, capacity - offset);
+            ssize_t written = m_writer->write(samples + offset, count);
+            if (written <= 0) {
+                ACSDK_ERROR(LX("readLoopFailed").d("reason", "writeFailed").d("result", written));
+                return;
+            }
+            readPos += count;
+        }
+        // If the writer caught up with the copy meanwhile, part of what was written is newer audio.
+        uint64_t newWritePos = audio_ring_write_pos(m_ring);
+        if (newWritePos - startPos > limit) {
+            ACSDK_WARN(LX("readLoop").d("reason", "copyOverrun").d("lostSamples", newWritePos - startPos - limit));
+            readPos = newWritePos;
+        }
+    }
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
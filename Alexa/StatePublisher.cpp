@@ -0,0 +1,176 @@
+/*
+ * StatePublisher.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cerrno>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+#include "SampleApp/ConsolePrinter.h"
+#include "SampleApp/ControlChannel.h"
+#include "SampleApp/StatePublisher.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/// String to identify log entries originating from this file.
+static const std::string TAG("StatePublisher");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// How often the worker checks for changes if no @c eventfd could be created.
+static const std::chrono::milliseconds FALLBACK_POLL_PERIOD{20};
+
+StatePublisher& StatePublisher::instance() {
+    static StatePublisher publisher;
+    return publisher;
+}
+
+StatePublisher::StatePublisher() :
+        m_dialogState{static_cast<int>(DialogUXState::IDLE)},
+        m_connectionStatus{static_cast<int>(ConnectionStatus::DISCONNECTED)},
+        m_isShuttingDown{false},
+        m_eventFd{-1} {
+#ifndef KWD_POCKETSPHINX
+    // Constructed first, the channel is destroyed after the worker has stopped using it.
+    ControlChannel::instance();
+#endif
+    m_eventFd = eventfd(0, EFD_CLOEXEC);
+    if (m_eventFd < 0) {
+        ACSDK_ERROR(LX("eventfdFailed").d("errno", errno).d("fallbackPollMs", FALLBACK_POLL_PERIOD.count()));
+    }
+    m_worker = std::thread(&StatePublisher::workLoop, this);
+}
+
+StatePublisher::~StatePublisher() {
+    m_isShuttingDown = true;
+    notify();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    if (m_eventFd >= 0) {
+        close(m_eventFd);
+    }
+}
+
+void StatePublisher::publishDialogState(DialogUXState state) {
+    m_dialogState.store(static_cast<int>(state), std::memory_order_release);
+    notify();
+}
+
+void StatePublisher::publishConnectionStatus(ConnectionStatus status) {
+    m_connectionStatus.store(static_cast<int>(status), std::memory_order_release);
+    notify();
+}
+
+void StatePublisher::notify() {
+    if (m_eventFd < 0) {
+        return;
+    }
+    // Adds to the counter; only blocks if it were about to overflow, which the worker's reads rule out.
+    uint64_t one = 1;
+    if (write(m_eventFd, &one, sizeof(one)) != sizeof(one)) {
+        ACSDK_ERROR(LX("notifyFailed").d("errno", errno));
+    }
+}
+
+void StatePublisher::workLoop() {
+    int reportedDialogState = m_dialogState.load(std::memory_order_acquire);
+    int reportedConnectionStatus = m_connectionStatus.load(std::memory_order_acquire);
+
+    while (!m_isShuttingDown) {
+        if (m_eventFd >= 0) {
+            uint64_t count;
+            if (read(m_eventFd, &count, sizeof(count)) < 0 && EINTR != errno) {
+                ACSDK_ERROR(LX("waitFailed").d("errno", errno));
+                std::this_thread::sleep_for(FALLBACK_POLL_PERIOD);
+            }
+        } else {
+            std::this_thread::sleep_for(FALLBACK_POLL_PERIOD);
+        }
+
+        int dialogState = m_dialogState.load(std::memory_order_acquire);
+        int connectionStatus = m_connectionStatus.load(std::memory_order_acquire);
+        if (dialogState == reportedDialogState && connectionStatus == reportedConnectionStatus) {
+            continue;
+        }
+        reportedDialogState = dialogState;
+        reportedConnectionStatus = connectionStatus;
+        report(static_cast<ConnectionStatus>(connectionStatus), static_cast<DialogUXState>(dialogState));
+    }
+}
+
+void StatePublisher::report(ConnectionStatus connectionStatus, DialogUXState dialogState) {
+    if (connectionStatus == ConnectionStatus::DISCONNECTED) {
+#ifndef KWD_POCKETSPHINX
+        ControlChannel::instance().sendState(ControlChannel::State::DISCONNECTED);
+#endif
+        ConsolePrinter::prettyPrint("Client not connected!");
+    } else if (connectionStatus == ConnectionStatus::PENDING) {
+#ifndef KWD_POCKETSPHINX
+        ControlChannel::instance().sendState(ControlChannel::State::CONNECTING);
+#endif
+        ConsolePrinter::prettyPrint("Connecting...");
+    } else if (connectionStatus == ConnectionStatus::CONNECTED) {
+        switch (dialogState) {
+            case DialogUXState::IDLE:
+#ifndef KWD_POCKETSPHINX
+                // The recognizer spots the wake word only while the client is idle.
+                ControlChannel::instance().sendState(ControlChannel::State::IDLE);
+#endif
+                ConsolePrinter::prettyPrint("Alexa is currently idle!");
+                return;
+
+            case DialogUXState::LISTENING:
+#ifndef KWD_POCKETSPHINX
+                ControlChannel::instance().sendState(ControlChannel::State::LISTENING);
+#endif
+                ConsolePrinter::prettyPrint("Listening...");
+                return;
+
+            case DialogUXState::THINKING:
+#ifndef KWD_POCKETSPHINX
+                ControlChannel::instance().sendState(ControlChannel::State::THINKING);
+#endif
+                ConsolePrinter::prettyPrint("Thinking...");
+                return;
+
+            case DialogUXState::SPEAKING:
+#ifndef KWD_POCKETSPHINX
+                ControlChannel::instance().sendState(ControlChannel::State::SPEAKING);
+#endif
+                ConsolePrinter::prettyPrint("Speaking...");
+                return;
+
+            /*
+             * This is an intermediate state after a SPEAK directive is completed. In the case of a speech burst the
+             * next SPEAK could kick in or if its the last SPEAK directive ALEXA moves to the IDLE state. So we do
+             * nothing for this state.
+             */
+            case DialogUXState::FINISHED:
+                return;
+        }
+    }
+}
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
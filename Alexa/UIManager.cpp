@@ -15,52 +15,62 @@
  * permissions and limitations under the License.
  */
 
+#include <atomic>
 #include <sstream>
 #include "SampleApp/UIManager.h"
 #include <AVSCommon/SDKInterfaces/DialogUXStateObserverInterface.h>
+#include <AVSCommon/Utils/Logger/Logger.h>
 #include "SampleApp/ConsolePrinter.h"
-
-// 2018/05/23 Bling Added
-#include <stdio.h>
-#include <stdlib.h>
-#include <errno.h>
-#include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
-
-struct my_msgbuf {
-    long mtype;
-    char mtext[20];
-};
-
-struct my_msgbuf buf;
-int msqid;
-key_t key;
-// 2018/05/23 Bling Added
+#include "SampleApp/LatencyStats.h"
+#include "SampleApp/StatePublisher.h"
 
 namespace alexaClientSDK {
 namespace sampleApp {
 
 using namespace avsCommon::sdkInterfaces;
 
+/// String to identify log entries originating from this file.
+static const std::string TAG("UIManager");
+
+/**
+ * Create a LogEntry using this file's TAG and the specified event string.
+ *
+ * @param The event string for this @c LogEntry.
+ */
+#define LX(event) alexaClientSDK::avsCommon::utils::logger::LogEntry(TAG, event)
+
+/// Nanoseconds per millisecond.
+static const int64_t NS_PER_MS = 1000000;
+
+/// The monotonic time the dialog became THINKING, or 0 once the reply started or the dialog moved on without one.
+static std::atomic<int64_t> thinkingNs{0};
+
 void UIManager::onDialogUXStateChanged(DialogUXState state) {
-    m_executor.submit([this, state]() {
-        if (state == m_dialogState) {
-            return;
+    // Timestamp on the notifying thread; the report is sent later by the publisher's worker.
+    if (DialogUXState::LISTENING == state) {
+        LatencyStats::instance().recordSinceKeyword(LatencyStats::Stage::KEYWORD_TO_LISTENING);
+    }
+    /*
+     * SPEAKING is entered when the speech player reports that playback started, so THINKING to SPEAKING is the time
+     * to the first sample of the reply. Only the first Speak of a reply is measured.
+     */
+    if (DialogUXState::THINKING == state) {
+        thinkingNs = LatencyStats::nowNs();
+    } else if (DialogUXState::SPEAKING == state) {
+        int64_t startNs = thinkingNs.exchange(0);
+        if (startNs) {
+            int64_t latencyNs = LatencyStats::nowNs() - startNs;
+            LatencyStats::instance().record(LatencyStats::Stage::THINKING_TO_SPEAKING, latencyNs);
+            ACSDK_INFO(LX("timeToFirstAudio").d("ms", latencyNs / NS_PER_MS));
         }
-        m_dialogState = state;
-        printState();
-    });
+    } else if (DialogUXState::FINISHED != state) {
+        thinkingNs = 0;
+    }
+    StatePublisher::instance().publishDialogState(state);
 }
 
 void UIManager::onConnectionStatusChanged(const Status status, const ChangedReason reason) {
-    m_executor.submit([this, status]() {
-        if (m_connectionStatus == status) {
-            return;
-        }
-        m_connectionStatus = status;
-        printState();
-    });
+    StatePublisher::instance().publishConnectionStatus(status);
 }
 
 void UIManager::onSettingChanged(const std::string& key, const std::string& value) {
@@ -90,62 +100,5 @@ void UIManager::onSetIndicator(avsCommon::avs::IndicatorState state) {
     });
 }
 
-void UIManager::printState() {
-    if (m_connectionStatus == avsCommon::sdkInterfaces::ConnectionStatusObserverInterface::Status::DISCONNECTED) {
-        ConsolePrinter::prettyPrint("Client not connected!");
-    } else if (m_connectionStatus == avsCommon::sdkInterfaces::ConnectionStatusObserverInterface::Status::PENDING) {
-        ConsolePrinter::prettyPrint("Connecting...");
-        // 2018/05/23 Bling Added
-        if ((key = ftok("/home/parallels/a113d.txt", 66)) == -1) {
-            perror("ftok");
-            exit(1);
-        }
-
-        if ((msqid = msgget(key, 0644 | IPC_CREAT)) == -1) {
-            perror("msgget");
-            exit(1);
-        }
-
-        buf.mtype = 1;
-        // 2018/05/23 Bling Added
-    } else if (m_connectionStatus == avsCommon::sdkInterfaces::ConnectionStatusObserverInterface::Status::CONNECTED) {
-        switch (m_dialogState) {
-            case DialogUXState::IDLE:
-                // 2018/05/23 Bling Added
-                strcpy(buf.mtext, "OK");
-                if (msgsnd(msqid, &buf, sizeof(buf), 0) == -1) {
-                    perror("msgsnd");
-                    exit(1);
-                }
-                // 2018/05/23 Bling Added
-                ConsolePrinter::prettyPrint("Alexa is currently idle!");                
-                return;
-
-            case DialogUXState::LISTENING:
-                ConsolePrinter::prettyPrint("Listening...");
-                // 2018/05/23 Bling Added
-                soundControl = 1;
-                // 2018/05/23 Bling Added
-                return;
-
-            case DialogUXState::THINKING:
-                ConsolePrinter::prettyPrint("Thinking...");                
-                return;
-
-            case DialogUXState::SPEAKING:
-                ConsolePrinter::prettyPrint("Speaking...");
-                return;
-
-            /*
-             * This is an intermediate state after a SPEAK directive is completed. In the case of a speech burst the
-             * next SPEAK could kick in or if its the last SPEAK directive ALEXA moves to the IDLE state. So we do
-             * nothing for this state.
-             */
-            case DialogUXState::FINISHED:
-                return;
-        }
-    }
-}
-
 }  // namespace sampleApp
 }  // namespace alexaClientSDK
@@ -0,0 +1,231 @@
+/*
+ * AsyncLogger.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_ASYNCLOGGER_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_ASYNCLOGGER_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <AVSCommon/Utils/Logger/Logger.h>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * The SDK's log sink for production. @c emit() copies the entry into a preallocated ring of fixed-size records under
+ * a short lock and returns; a worker thread formats the time stamps and writes the records to the console in
+ * batches, one write per batch. Each category (the source tag an entry starts with) has a token bucket, so one chatty
+ * component cannot flood the console: entries over its rate are counted and the count is printed with the next
+ * batch, or within a second if nothing else is logged. ERROR and CRITICAL entries are never rate-limited. If the
+ * worker falls a whole ring behind, new entries are dropped and counted the same way rather than waited for.
+ */
+class AsyncLogger : public avsCommon::utils::logger::Logger {
+public:
+    /**
+     * Creates the logger and starts its worker.
+     *
+     * @param level The lowest level that is logged.
+     * @return The logger.
+     */
+    static std::shared_ptr<AsyncLogger> create(avsCommon::utils::logger::Level level);
+
+    /**
+     * Sets the per-category rate limit. Takes effect for new entries.
+     *
+     * @param entriesPerSecond The sustained rate each category may log at; 0 removes the limit.
+     * @param burst How many entries a category may log at once after being quiet.
+     */
+    void setRateLimit(unsigned int entriesPerSecond, unsigned int burst);
+
+    void emit(
+        avsCommon::utils::logger::Level level,
+        std::chrono::system_clock::time_point time,
+        const char* threadMoniker,
+        const char* text) override;
+
+    /**
+     * Destructor. Writes what is still queued and stops the worker.
+     */
+    ~AsyncLogger();
+
+private:
+    /// The longest entry text kept; longer entries are truncated.
+    static const size_t MAX_TEXT_SIZE = 480;
+
+    /// The longest thread moniker kept.
+    static const size_t MAX_THREAD_MONIKER_SIZE = 16;
+
+    /// The longest category name kept.
+    static const size_t MAX_CATEGORY_SIZE = 32;
+
+    /// The number of categories that are limited separately; further ones share the last bucket.
+    static const size_t MAX_CATEGORIES = 64;
+
+    /// An entry as it waits for the worker, unformatted.
+    struct Record {
+        /// The level.
+        avsCommon::utils::logger::Level level;
+        /// When it was logged.
+        std::chrono::system_clock::time_point time;
+        /// The thread that logged it, nul-terminated.
+        char threadMoniker[MAX_THREAD_MONIKER_SIZE];
+        /// The length of @c text.
+        uint16_t length;
+        /// The text, not nul-terminated.
+        char text[MAX_TEXT_SIZE];
+    };
+
+    /// The rate limit of one category.
+    struct Bucket {
+        /// The hash of the category, or 0 if the bucket is unused.
+        uint32_t hash;
+        /// The category, nul-terminated.
+        char name[MAX_CATEGORY_SIZE];
+        /// Entries the category may still log.
+        double tokens;
+        /// When @c tokens was last refilled, in monotonic nanoseconds.
+        int64_t refillNs;
+        /// Entries dropped since the last report.
+        uint64_t suppressed;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param level The lowest level that is logged.
+     */
+    AsyncLogger(avsCommon::utils::logger::Level level);
+
+    /**
+     * Finds the bucket of the category @c text starts with, claiming a free one for a new category. Called with
+     * @c m_mutex held.
+     *
+     * @param text The entry text.
+     * @return The bucket.
+     */
+    Bucket& findBucket(const char* text);
+
+    /**
+     * Takes a token from @c bucket. Called with @c m_mutex held.
+     *
+     * @param bucket The category's bucket.
+     * @param nowNs The monotonic time.
+     * @return Whether the entry may be logged.
+     */
+    bool takeToken(Bucket& bucket, int64_t nowNs);
+
+    /**
+     * Copies an entry into the ring, which has room for it. Called with @c m_mutex held.
+     *
+     * @param level The level.
+     * @param time When the entry was logged.
+     * @param threadMoniker The thread that logged it.
+     * @param text The text.
+     * @param length The length of @c text, at most @c MAX_TEXT_SIZE.
+     */
+    void queue(
+        avsCommon::utils::logger::Level level,
+        std::chrono::system_clock::time_point time,
+        const char* threadMoniker,
+        const char* text,
+        size_t length);
+
+    /**
+     * Notes that a suppressed or dropped entry is waiting to be reported. Called with @c m_mutex held.
+     *
+     * @return Whether the worker needs waking to start the report timer.
+     */
+    bool addReport();
+
+    /// The body of the worker thread.
+    void writeLoop();
+
+    /**
+     * Appends a formatted line to @c out, in the format of the SDK's console logger.
+     *
+     * @param level The level.
+     * @param time When the entry was logged.
+     * @param threadMoniker The thread that logged it.
+     * @param text The text.
+     * @param length The length of @c text.
+     * @param out The batch being built.
+     */
+    void format(
+        avsCommon::utils::logger::Level level,
+        std::chrono::system_clock::time_point time,
+        const char* threadMoniker,
+        const char* text,
+        size_t length,
+        std::string* out);
+
+    /// Serializes the ring indices, the buckets and the limits.
+    std::mutex m_mutex;
+
+    /// Wakes the worker.
+    std::condition_variable m_wake;
+
+    /// The preallocated ring.
+    std::vector<Record> m_records;
+
+    /// The number of records the worker has written.
+    uint64_t m_head;
+
+    /// The number of records queued; the next one goes to @c m_records[m_tail % size].
+    uint64_t m_tail;
+
+    /// Entries dropped because the ring was full, since the last report.
+    uint64_t m_dropped;
+
+    /// The rate limits.
+    std::array<Bucket, MAX_CATEGORIES> m_buckets;
+
+    /// The sustained entries per second of each category, or 0 for no limit.
+    double m_rate;
+
+    /// The most tokens a bucket holds.
+    double m_burst;
+
+    /// Whether any bucket's @c suppressed count or @c m_dropped is non-zero.
+    bool m_hasReports;
+
+    /// Whether the worker is waiting on @c m_wake.
+    bool m_isWorkerWaiting;
+
+    /// Whether the worker should exit once the ring is empty and nothing is left to report.
+    bool m_isShuttingDown;
+
+    /// The second the worker last formatted a date for, to reuse @c m_dateText.
+    time_t m_dateSecond;
+
+    /// The date and time of @c m_dateSecond, "YYYY-MM-DD HH:MM:SS".
+    char m_dateText[32];
+
+    /// The worker thread.
+    std::thread m_worker;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_ASYNCLOGGER_H_
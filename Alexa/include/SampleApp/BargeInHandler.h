@@ -0,0 +1,156 @@
+/*
+ * BargeInHandler.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_BARGEINHANDLER_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_BARGEINHANDLER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <AVSCommon/SDKInterfaces/DialogUXStateObserverInterface.h>
+#include <AVSCommon/SDKInterfaces/SpeakerManagerInterface.h>
+
+#include "SampleApp/InteractionManager.h"
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * Handles a wake word heard while Alexa is speaking. Depending on the configured mode, the current response is
+ * stopped, or the speech and audio players are turned down until the dialog is idle again, before the new request
+ * starts. Without barge-in the user would have to wait for a long response to finish. A wake word while Alexa is
+ * thinking is not a barge-in: the request in flight keeps the AudioInputProcessor busy and it refuses a new one.
+ * Ducking and restoring wait for the SpeakerManager, so they run in order on a worker thread of the handler's own and
+ * neither the wake word nor the SDK's observer thread waits for them.
+ */
+class BargeInHandler : public avsCommon::sdkInterfaces::DialogUXStateObserverInterface {
+public:
+    /// What happens to the current output on a barge-in.
+    enum class Mode {
+        /// Nothing; the new request takes the dialog channel when it starts.
+        NONE,
+        /// Stop the foreground activity.
+        STOP,
+        /// Turn the AVS-synced players down to the duck volume until the dialog is idle.
+        DUCK
+    };
+
+    /**
+     * Parses a mode name from the configuration.
+     *
+     * @param name "none", "stop" or "duck".
+     * @param[out] mode The mode.
+     * @return @c true if @c name is a mode and @c false otherwise.
+     */
+    static bool parseMode(const std::string& name, Mode* mode);
+
+    /**
+     * Constructor.
+     *
+     * @param mode What to do on a barge-in.
+     * @param duckVolume The volume the players are turned down to in @c Mode::DUCK.
+     * @param speakerManager The speaker manager the players are turned down through, locally and without telling AVS.
+     */
+    BargeInHandler(
+        Mode mode,
+        int8_t duckVolume,
+        std::shared_ptr<avsCommon::sdkInterfaces::SpeakerManagerInterface> speakerManager);
+
+    /**
+     * Destructor. Carries out the requests still queued and stops the worker.
+     */
+    ~BargeInHandler();
+
+    /**
+     * Called on a wake word, before the request starts.
+     *
+     * @param interactionManager The interaction manager the request will be started on.
+     * @return @c true if Alexa was speaking, i.e. this was a barge-in, and @c false otherwise.
+     */
+    bool onWakeWord(std::shared_ptr<InteractionManager> interactionManager);
+
+    /// @name DialogUXStateObserverInterface Functions
+    /// @{
+    void onDialogUXStateChanged(DialogUXState newState) override;
+    /// @}
+
+private:
+    /// What the worker is asked to do.
+    enum class Request {
+        /// Call @c duck().
+        DUCK,
+        /// Call @c restore().
+        RESTORE
+    };
+
+    /**
+     * Queues a request for the worker.
+     *
+     * @param request The request.
+     */
+    void request(Request request);
+
+    /// The body of the worker thread.
+    void workLoop();
+
+    /// Turns the players down, saving their volume. Called by the worker.
+    void duck();
+
+    /// Restores the saved volume unless it was changed while ducked. Called by the worker.
+    void restore();
+
+    /// What to do on a barge-in.
+    const Mode m_mode;
+
+    /// The volume the players are turned down to.
+    const int8_t m_duckVolume;
+
+    /// Sets the volume of the players, so that it stays in step with what the SDK reports.
+    const std::shared_ptr<avsCommon::sdkInterfaces::SpeakerManagerInterface> m_speakerManager;
+
+    /// The latest dialog state.
+    std::atomic<DialogUXState> m_dialogState;
+
+    /// Serializes @c m_requests and @c m_isShuttingDown.
+    std::mutex m_mutex;
+
+    /// Wakes the worker.
+    std::condition_variable m_wake;
+
+    /// The requests the worker has yet to carry out, oldest first.
+    std::deque<Request> m_requests;
+
+    /// Whether the worker should exit once @c m_requests is empty.
+    bool m_isShuttingDown;
+
+    /// Whether the players are ducked. Only the worker uses it.
+    bool m_isDucked;
+
+    /// The volume before ducking. Only the worker uses it.
+    int8_t m_savedVolume;
+
+    /// The worker thread.
+    std::thread m_worker;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_BARGEINHANDLER_H_
@@ -0,0 +1,150 @@
+/*
+ * ControlChannel.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_CONTROLCHANNEL_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_CONTROLCHANNEL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * The client's end of the binary control protocol with the recognizer (see Pocketsphinx/ctlproto.h). The client
+ * reports its dialog state, which the recognizer uses to gate keyword detection, and receives keywords. Messages are
+ * datagrams on a Unix socket and are sent without blocking, so a missing or slow recognizer never holds up the
+ * client. Each state report acknowledges the last keyword acted on, so the recognizer can tell stale reports apart.
+ * A keyword that starts a dialog is acknowledged with the state it leads to, not with the state it was heard in, so
+ * the recognizer does not take the client for idle while the request is still being set up.
+ */
+class ControlChannel {
+public:
+    /// The dialog states reported to the recognizer.
+    enum class State { DISCONNECTED, CONNECTING, IDLE, LISTENING, THINKING, SPEAKING };
+
+    /// A keyword received from the recognizer.
+    struct Keyword {
+        /// The detected phrase.
+        std::string phrase;
+        /// The index of the keyword in the recognizer's table, or -1.
+        int32_t id;
+        /// The sequence number of the message.
+        uint32_t seq;
+        /// The @c CLOCK_MONOTONIC time at which the keyword ended.
+        int64_t keywordEndNs;
+        /// The azimuth of the talker in degrees, or -1 if the recognizer has no microphone array.
+        int doaDegrees;
+    };
+
+    /**
+     * Returns the process-wide channel, binding its socket on first use.
+     *
+     * @return The @c ControlChannel singleton.
+     */
+    static ControlChannel& instance();
+
+    /**
+     * Reports a dialog state to the recognizer. The state is remembered, to be reported again on acknowledgements.
+     *
+     * @param state The new state.
+     */
+    void sendState(State state);
+
+    /**
+     * Waits for the next keyword. Hellos from a (re)started recognizer are answered on the way. Only one thread may
+     * receive, and it must call @c acknowledge() or @c acknowledgeOnStateChange() once it has acted on each keyword.
+     *
+     * @param[out] keyword The keyword received.
+     * @return @c true on success and @c false if the channel is unusable.
+     */
+    bool receiveKeyword(Keyword* keyword);
+
+    /**
+     * Acknowledges a keyword (or hello) by reporting the current state again.
+     *
+     * @param seq The sequence number of the message acted on.
+     */
+    void acknowledge(uint32_t seq);
+
+    /**
+     * Acknowledges a keyword with the next state reported, for an action that changes the dialog state
+     * asynchronously. If no state is reported within @c timeout, e.g. because the action failed, the acknowledgement
+     * is sent with the current state from @c receiveKeyword().
+     *
+     * @param seq The sequence number of the keyword acted on.
+     * @param timeout How long to wait for a state change.
+     */
+    void acknowledgeOnStateChange(uint32_t seq, std::chrono::milliseconds timeout);
+
+    /**
+     * Like @c acknowledgeOnStateChange(), but waits for a particular state. States reported before it are sent
+     * without the acknowledgement, so the recognizer keeps treating them as stale.
+     *
+     * @param seq The sequence number of the keyword acted on.
+     * @param state The state to acknowledge with.
+     * @param timeout How long to wait for @c state.
+     */
+    void acknowledgeOnState(uint32_t seq, State state, std::chrono::milliseconds timeout);
+
+    /**
+     * Destructor.
+     */
+    ~ControlChannel();
+
+private:
+    /// Constructor.
+    ControlChannel();
+
+    /// Sends the current state. @c m_mutex must be held.
+    void sendStateLocked();
+
+    /// Serializes sending and the fields below.
+    std::mutex m_mutex;
+
+    /// The socket, or -1 if it could not be bound.
+    int m_fd;
+
+    /// The sequence number of the last message sent.
+    uint32_t m_seq;
+
+    /// The sequence number of the last recognizer message acted on.
+    uint32_t m_ackSeq;
+
+    /// The last reported state.
+    State m_state;
+
+    /// Whether an acknowledgement waits for the next state change.
+    bool m_hasPendingAck;
+
+    /// The sequence number the pending acknowledgement is for.
+    uint32_t m_pendingAckSeq;
+
+    /// Whether the pending acknowledgement waits for @c m_pendingAckState rather than for any state.
+    bool m_pendingAckNeedsState;
+
+    /// The state the pending acknowledgement waits for.
+    State m_pendingAckState;
+
+    /// When the pending acknowledgement is sent with the current state instead.
+    std::chrono::steady_clock::time_point m_pendingAckDeadline;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_CONTROLCHANNEL_H_
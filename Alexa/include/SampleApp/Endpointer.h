@@ -0,0 +1,154 @@
+/*
+ * Endpointer.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_ENDPOINTER_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_ENDPOINTER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <AVSCommon/AVS/AudioInputStream.h>
+#include <AVSCommon/SDKInterfaces/DialogUXStateObserverInterface.h>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * Detects the end of the user's request on the device, so that the upload of a tap-to-talk request stops as soon as
+ * the user stops talking instead of when AVS notices the trailing silence. While the dialog is LISTENING it reads the
+ * shared data stream in 10 ms frames and classifies them by energy against an adaptive noise floor. Once there has
+ * been enough speech, a silence as long as the hangover ends the request. The time from the end of speech to the
+ * endpoint and from the endpoint to THINKING is recorded in @c LatencyStats.
+ */
+class Endpointer : public avsCommon::sdkInterfaces::DialogUXStateObserverInterface {
+public:
+    /**
+     * Creates an endpointer and starts its thread, which sleeps until the dialog is LISTENING.
+     *
+     * @param stream The stream the request is uploaded from.
+     * @param hangover How long the user must be silent after speaking.
+     * @param minSpeech How much speech must be heard before a silence counts.
+     * @param onEndOfSpeech Called on the endpointer's thread at the end of the request, e.g. to call
+     * @c notifyOfTapToTalkEnd().
+     * @return The endpointer, or @c nullptr if the parameters are invalid.
+     */
+    static std::shared_ptr<Endpointer> create(
+        std::shared_ptr<avsCommon::avs::AudioInputStream> stream,
+        std::chrono::milliseconds hangover,
+        std::chrono::milliseconds minSpeech,
+        std::function<void()> onEndOfSpeech);
+
+    /**
+     * Sets where the next request's audio starts, e.g. the end of the wake word, so that speech between there and
+     * LISTENING counts towards the minimum. Call before the tap.
+     *
+     * @param beginIndex The stream index the request streams from, or @c INVALID_INDEX to start at the writer.
+     */
+    void setRequestBegin(avsCommon::avs::AudioInputStream::Index beginIndex);
+
+    void onDialogUXStateChanged(DialogUXState newState) override;
+
+    /// No request begin index, as @c AudioInputProcessor::INVALID_INDEX.
+    static const avsCommon::avs::AudioInputStream::Index INVALID_INDEX;
+
+    /**
+     * Destructor. Stops the thread.
+     */
+    ~Endpointer();
+
+private:
+    /**
+     * Constructor.
+     *
+     * @param stream The stream the request is uploaded from.
+     * @param hangover How long the user must be silent after speaking.
+     * @param minSpeech How much speech must be heard before a silence counts.
+     * @param onEndOfSpeech Called at the end of the request.
+     */
+    Endpointer(
+        std::shared_ptr<avsCommon::avs::AudioInputStream> stream,
+        std::chrono::milliseconds hangover,
+        std::chrono::milliseconds minSpeech,
+        std::function<void()> onEndOfSpeech);
+
+    /// The body of the thread: waits for LISTENING, then runs @c detect().
+    void detectLoop();
+
+    /**
+     * Reads the stream, from the request's begin index if one was set, until the end of speech or until the dialog
+     * leaves LISTENING.
+     *
+     * @param listenCount The value of @c m_listenCount when this LISTENING began.
+     * @param beginIndex Where the request's audio starts, or @c INVALID_INDEX.
+     * @return Whether the end of speech was detected.
+     */
+    bool detect(uint64_t listenCount, avsCommon::avs::AudioInputStream::Index beginIndex);
+
+    /**
+     * Whether the LISTENING that began as @c listenCount is still on.
+     *
+     * @param listenCount The value of @c m_listenCount when it began.
+     * @return @c true while the dialog is in that LISTENING.
+     */
+    bool isStillListening(uint64_t listenCount);
+
+    /// The stream the request is uploaded from.
+    const std::shared_ptr<avsCommon::avs::AudioInputStream> m_stream;
+
+    /// How long the user must be silent after speaking.
+    const std::chrono::milliseconds m_hangover;
+
+    /// How much speech must be heard before a silence counts.
+    const std::chrono::milliseconds m_minSpeech;
+
+    /// Called at the end of the request.
+    const std::function<void()> m_onEndOfSpeech;
+
+    /// Serializes the state below.
+    std::mutex m_mutex;
+
+    /// Wakes the thread when the dialog state changes or on shutdown.
+    std::condition_variable m_wake;
+
+    /// Whether the dialog is LISTENING.
+    bool m_isListening;
+
+    /// Incremented whenever the dialog enters LISTENING, so a new request is told apart from the last one.
+    uint64_t m_listenCount;
+
+    /// Whether the thread should exit.
+    bool m_isShuttingDown;
+
+    /// Where the next request's audio starts, or @c INVALID_INDEX; taken by the LISTENING that follows.
+    avsCommon::avs::AudioInputStream::Index m_requestBeginIndex;
+
+    /// The monotonic time of the last endpoint, or 0 once THINKING was recorded.
+    std::atomic<int64_t> m_endpointNs;
+
+    /// The thread.
+    std::thread m_thread;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_ENDPOINTER_H_
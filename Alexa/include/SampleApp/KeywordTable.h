@@ -0,0 +1,116 @@
+/*
+ * KeywordTable.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_KEYWORDTABLE_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_KEYWORDTABLE_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * The wake words and what each of them does, loaded once from the keyword table shared with the recognizer. The
+ * table has one keyword per line, "<phrase> [/<threshold>/ [<action> [<argument>]]]", e.g.
+ *
+ * @code
+ * alexa /1e-20/ tap
+ * stop playing /1e-15/ stop
+ * turn it up /1e-20/ volume 10
+ * @endcode
+ *
+ * A line without slashes is all phrase and taps. Lines starting with '#' are comments. The rules are those of the
+ * recognizer's @c keywords_load(): a malformed line is skipped with a warning and of two lines with the same phrase
+ * the first one is kept. Keywords are kept in a hash map keyed by phrase, so mapping a detection to its action is a
+ * single lookup.
+ */
+class KeywordTable {
+public:
+    /// What a keyword does when it is detected.
+    enum class Action {
+        /// Start a tap-to-talk interaction.
+        TAP,
+        /// Stop the foreground activity.
+        STOP,
+        /// Change the speaker volume by @c Keyword::volumeDelta.
+        VOLUME
+    };
+
+    /// A single entry of the table.
+    struct Keyword {
+        /// The phrase, with words separated by single spaces.
+        std::string phrase;
+        /// The keyphrase search threshold, or a negative value to use the detector's default.
+        double threshold;
+        /// What to do on detection.
+        Action action;
+        /// The volume change for @c Action::VOLUME.
+        int volumeDelta;
+    };
+
+    /**
+     * Loads a keyword table. If @c path does not exist, the last line of @c corpusPath becomes the only keyword, with
+     * the @c TAP action, which is what older setups use.
+     *
+     * @param path The keyword table.
+     * @param corpusPath The single-keyword corpus file used when there is no table.
+     * @return The table, or @c nullptr if neither file has a valid keyword.
+     */
+    static std::unique_ptr<KeywordTable> create(const std::string& path, const std::string& corpusPath);
+
+    /**
+     * Looks up a detected phrase.
+     *
+     * @param phrase The phrase reported by the recognizer.
+     * @return The keyword, or @c nullptr if the phrase is not in the table.
+     */
+    const Keyword* find(const std::string& phrase) const;
+
+    /**
+     * Writes the phrases and thresholds as a Sphinx keyword file, which @c ps_set_kws() and the @c -kws option read.
+     *
+     * @param path The file to write.
+     * @param defaultThreshold The threshold of keywords without one.
+     * @return @c true if the file was written and @c false otherwise.
+     */
+    bool writeKwsFile(const std::string& path, double defaultThreshold) const;
+
+    /**
+     * Gets the number of keywords.
+     *
+     * @return The number of keywords.
+     */
+    size_t size() const;
+
+private:
+    /**
+     * Parses one line of the table.
+     *
+     * @param line The line, without the newline.
+     * @return @c true if the line was empty, a comment or a valid keyword, including a duplicate, which is ignored,
+     * and @c false otherwise.
+     */
+    bool addLine(const std::string& line);
+
+    /// The keywords, keyed by phrase.
+    std::unordered_map<std::string, Keyword> m_keywords;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_KEYWORDTABLE_H_
@@ -0,0 +1,172 @@
+/*
+ * LatencyStats.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_LATENCYSTATS_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_LATENCYSTATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * Collects wake-word-to-Recognize latency on the client side. Every stage keeps a fixed log-scale histogram of
+ * atomic counters (four buckets per octave of microseconds), so recording is lock-free and can be done from SDK
+ * observer callbacks. Times are @c CLOCK_MONOTONIC nanoseconds, which is the clock the recognizer process stamps
+ * the end of the keyword with, so stages can be measured across the process boundary.
+ */
+class LatencyStats {
+public:
+    /// The measured stages, each relative to the end of the wake word.
+    enum class Stage {
+        /// The client has received the wake word.
+        KEYWORD_TO_RECEIVE,
+        /// @c notifyOfTapToTalk() has been accepted.
+        KEYWORD_TO_TAP,
+        /// The dialog state has become LISTENING.
+        KEYWORD_TO_LISTENING,
+        /// Not relative to the wake word: send to receipt of the recognizer's keyword message.
+        KEYWORD_DELIVERY,
+        /// Not relative to the wake word: end of the user's speech to the local endpoint.
+        SPEECH_END_TO_ENDPOINT,
+        /// Not relative to the wake word: local endpoint to the dialog state THINKING.
+        ENDPOINT_TO_THINKING,
+        /// Not relative to the wake word: start of the SampleApp to connected, with the wake word armed.
+        BOOT_TO_LISTENING,
+        /// Not relative to the wake word: dialog state THINKING to SPEAKING, i.e. to the first sample of the reply.
+        THINKING_TO_SPEAKING,
+        /// Number of stages.
+        COUNT
+    };
+
+    /**
+     * Returns the process-wide instance.
+     *
+     * @return The @c LatencyStats singleton.
+     */
+    static LatencyStats& instance();
+
+    /**
+     * Reads the monotonic clock.
+     *
+     * @return The current @c CLOCK_MONOTONIC time in nanoseconds.
+     */
+    static int64_t nowNs();
+
+    /**
+     * Starts measuring a new interaction.
+     *
+     * @param keywordEndNs The monotonic time at which the wake word ended.
+     */
+    void markKeyword(int64_t keywordEndNs);
+
+    /**
+     * Records the time from the last @c markKeyword() to now for @c stage. Each stage is recorded at most once per
+     * interaction, so later state changes of the same dialog do not skew the histogram.
+     *
+     * @param stage The stage that has just been reached.
+     */
+    void recordSinceKeyword(Stage stage);
+
+    /**
+     * Records one latency sample.
+     *
+     * @param stage The stage to record into.
+     * @param latencyNs The latency in nanoseconds.
+     */
+    void record(Stage stage, int64_t latencyNs);
+
+    /**
+     * Formats count, p50, p95, p99 and max of every stage, one line per stage.
+     *
+     * @return The formatted statistics.
+     */
+    std::string dump() const;
+
+    /**
+     * Starts a thread that rewrites @c path with @c dump() every @c period.
+     *
+     * @param path The file to write.
+     * @param period The time between writes.
+     */
+    void startDumping(const std::string& path, std::chrono::seconds period);
+
+    /**
+     * Destructor. Stops the dump thread.
+     */
+    ~LatencyStats();
+
+private:
+    /// Number of histogram buckets per stage.
+    static constexpr int NUM_BUCKETS = 128;
+
+    /// The histogram of a single stage.
+    struct Histogram {
+        /// Sample counts per bucket.
+        std::array<std::atomic<uint32_t>, NUM_BUCKETS> buckets;
+        /// Total number of samples.
+        std::atomic<uint32_t> count;
+        /// Largest sample in nanoseconds.
+        std::atomic<int64_t> maxNs;
+    };
+
+    /// Constructor.
+    LatencyStats();
+
+    /**
+     * Computes the upper bound of a percentile.
+     *
+     * @param histogram The histogram.
+     * @param percentile The percentile in (0, 1].
+     * @return The upper bound in nanoseconds, or 0 if the histogram is empty.
+     */
+    static int64_t percentileNs(const Histogram& histogram, double percentile);
+
+    /// The body of the dump thread.
+    void dumpLoop(std::string path, std::chrono::seconds period);
+
+    /// One histogram per stage.
+    std::array<Histogram, static_cast<size_t>(Stage::COUNT)> m_histograms;
+
+    /// The end of the wake word of the current interaction.
+    std::atomic<int64_t> m_keywordEndNs;
+
+    /// One bit per stage not yet recorded for the current interaction.
+    std::atomic<uint32_t> m_pendingStages;
+
+    /// Serializes @c m_isShuttingDown and the dump thread's wait.
+    std::mutex m_mutex;
+
+    /// Wakes the dump thread on shutdown.
+    std::condition_variable m_wakeDumpThread;
+
+    /// Whether the dump thread should exit.
+    bool m_isShuttingDown;
+
+    /// The thread writing the statistics file.
+    std::thread m_dumpThread;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_LATENCYSTATS_H_
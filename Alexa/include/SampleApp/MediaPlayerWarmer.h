@@ -0,0 +1,91 @@
+/*
+ * MediaPlayerWarmer.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_MEDIAPLAYERWARMER_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_MEDIAPLAYERWARMER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <AVSCommon/Utils/MediaPlayer/MediaPlayerInterface.h>
+#include <AVSCommon/Utils/MediaPlayer/MediaPlayerObserverInterface.h>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * Plays a fraction of a second of silent MP3 through a media player. The first playback of the process loads the
+ * typefinder, MP3 parser and decoder, converter and sink plugins, which otherwise delays the first reply of the
+ * session; they stay loaded for every player. The SDK's player builds a new pipeline for every source, so the audio
+ * device itself is opened again by each reply. The player is left with no observer, so use one the SDK does not.
+ */
+class MediaPlayerWarmer : public avsCommon::utils::mediaPlayer::MediaPlayerObserverInterface {
+public:
+    /**
+     * Plays the silence through @c player and waits until it has finished.
+     *
+     * @param player The player to warm up.
+     * @param timeout How long to wait before stopping the silence.
+     * @return Whether the silence played to the end within @c timeout.
+     */
+    static bool warm(
+        std::shared_ptr<avsCommon::utils::mediaPlayer::MediaPlayerInterface> player,
+        std::chrono::milliseconds timeout);
+
+    void onPlaybackStarted(SourceId id) override;
+    void onPlaybackFinished(SourceId id) override;
+    void onPlaybackError(SourceId id, const avsCommon::utils::mediaPlayer::ErrorType& type, std::string error)
+        override;
+    void onPlaybackStopped(SourceId id) override;
+
+private:
+    /// Constructor.
+    MediaPlayerWarmer();
+
+    /**
+     * Ends the wait.
+     *
+     * @param succeeded Whether the silence played to the end.
+     */
+    void finish(bool succeeded);
+
+    /**
+     * Waits for @c finish().
+     *
+     * @param timeout How long to wait.
+     * @return Whether the silence played to the end.
+     */
+    bool waitForFinish(std::chrono::milliseconds timeout);
+
+    /// Serializes the state below.
+    std::mutex m_mutex;
+
+    /// Wakes @c waitForFinish().
+    std::condition_variable m_wake;
+
+    /// Whether the playback has ended.
+    bool m_isFinished;
+
+    /// Whether it ended at the end of the silence.
+    bool m_succeeded;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_MEDIAPLAYERWARMER_H_
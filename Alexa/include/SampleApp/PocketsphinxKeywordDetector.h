@@ -0,0 +1,145 @@
+/*
+ * PocketsphinxKeywordDetector.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_POCKETSPHINXKEYWORDDETECTOR_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_POCKETSPHINXKEYWORDDETECTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include <AVSCommon/AVS/AudioInputStream.h>
+#include <AVSCommon/SDKInterfaces/KeyWordDetectorStateObserverInterface.h>
+#include <AVSCommon/SDKInterfaces/KeyWordObserverInterface.h>
+#include <AVSCommon/Utils/AudioFormat.h>
+#include <KWD/AbstractKeywordDetector.h>
+
+#include <pocketsphinx.h>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * A keyword detector that runs the CMU Sphinx keyword search inside the client process. It reads the same
+ * @c AudioInputStream that the microphone writes to, so no second audio capture and no inter-process handoff are
+ * needed between hearing the wake word and notifying the keyword observers.
+ */
+class PocketsphinxKeywordDetector : public kwd::AbstractKeywordDetector {
+public:
+    /**
+     * Creates a @c PocketsphinxKeywordDetector.
+     *
+     * @param stream The stream of audio data. This should be formatted in LPCM encoded with 16 bits per sample and
+     * have a sample rate of 16 kHz. Additionally, the data should be in little endian format.
+     * @param audioFormat The format of the audio data located within the stream.
+     * @param keyWordObservers The observers to notify of keyword detections.
+     * @param keyWordDetectorStateObservers The observers to notify of state changes in the engine.
+     * @param hmmPath The path to the acoustic model directory.
+     * @param dictPath The path to the pronunciation dictionary.
+     * @param kwsPath A Sphinx keyword file with one "phrase /threshold/" per line, e.g. written by
+     * @c KeywordTable::writeKwsFile(). Every word must be present in the dictionary.
+     * @param msToPushIntoEngine The amount of data in milliseconds to push to the decoder at a time.
+     * @return A new @c PocketsphinxKeywordDetector, or @c nullptr if the operation failed.
+     */
+    static std::unique_ptr<PocketsphinxKeywordDetector> create(
+        std::shared_ptr<avsCommon::avs::AudioInputStream> stream,
+        avsCommon::utils::AudioFormat audioFormat,
+        std::unordered_set<std::shared_ptr<avsCommon::sdkInterfaces::KeyWordObserverInterface>> keyWordObservers,
+        std::unordered_set<std::shared_ptr<avsCommon::sdkInterfaces::KeyWordDetectorStateObserverInterface>>
+            keyWordDetectorStateObservers,
+        const std::string& hmmPath,
+        const std::string& dictPath,
+        const std::string& kwsPath,
+        std::chrono::milliseconds msToPushIntoEngine = std::chrono::milliseconds(20));
+
+    /**
+     * Destructor.
+     */
+    ~PocketsphinxKeywordDetector() override;
+
+private:
+    /**
+     * Constructor.
+     *
+     * @param stream The stream of audio data.
+     * @param audioFormat The format of the audio data located within the stream.
+     * @param keyWordObservers The observers to notify of keyword detections.
+     * @param keyWordDetectorStateObservers The observers to notify of state changes in the engine.
+     * @param msToPushIntoEngine The amount of data in milliseconds to push to the decoder at a time.
+     */
+    PocketsphinxKeywordDetector(
+        std::shared_ptr<avsCommon::avs::AudioInputStream> stream,
+        avsCommon::utils::AudioFormat audioFormat,
+        std::unordered_set<std::shared_ptr<avsCommon::sdkInterfaces::KeyWordObserverInterface>> keyWordObservers,
+        std::unordered_set<std::shared_ptr<avsCommon::sdkInterfaces::KeyWordDetectorStateObserverInterface>>
+            keyWordDetectorStateObservers,
+        std::chrono::milliseconds msToPushIntoEngine);
+
+    /**
+     * Initializes the stream reader, sets up the decoder and kicks off the detection thread.
+     *
+     * @param hmmPath The path to the acoustic model directory.
+     * @param dictPath The path to the pronunciation dictionary.
+     * @param kwsPath The Sphinx keyword file.
+     * @return @c true if the engine was initialized properly and @c false otherwise.
+     */
+    bool init(const std::string& hmmPath, const std::string& dictPath, const std::string& kwsPath);
+
+    /// The main function that reads data and feeds it into the decoder.
+    void detectionLoop();
+
+    /**
+     * Restarts the utterance so that the keyphrase search starts from a clean state, at the reader's position. Called
+     * after each detection and after each overrun, which moves the reader.
+     *
+     * @return @c true if the utterance was restarted and @c false otherwise.
+     */
+    bool restartUtterance();
+
+    /// Indicates whether the internal main loop should keep running.
+    std::atomic<bool> m_isShuttingDown;
+
+    /// The stream of audio data.
+    const std::shared_ptr<avsCommon::avs::AudioInputStream> m_stream;
+
+    /// The reader that will be used to read audio data from the stream.
+    std::shared_ptr<avsCommon::avs::AudioInputStream::Reader> m_streamReader;
+
+    /// The Sphinx configuration used to create @c m_decoder.
+    cmd_ln_t* m_config;
+
+    /// The Sphinx decoder running the keyword search.
+    ps_decoder_t* m_decoder;
+
+    /// The stream index of the first sample of the current utterance.
+    avsCommon::avs::AudioInputStream::Index m_utteranceBeginIndex;
+
+    /// The number of stream samples per decoder frame.
+    const size_t m_samplesPerFrame;
+
+    /// Internal thread that reads audio from the buffer and feeds it to the decoder.
+    std::thread m_detectionThread;
+
+    /// The max number of samples to push into the decoder per iteration of the detection loop.
+    const size_t m_maxSamplesPerPush;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_POCKETSPHINXKEYWORDDETECTOR_H_
@@ -0,0 +1,123 @@
+/*
+ * SampleApplication.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_SAMPLEAPPLICATION_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_SAMPLEAPPLICATION_H_
+
+#include <memory>
+
+#include <AVSCommon/AVS/AudioInputStream.h>
+#include <AVSCommon/Utils/AudioFormat.h>
+#include <DefaultClient/DefaultClient.h>
+#include <MediaPlayer/MediaPlayer.h>
+
+#include "SampleApp/BargeInHandler.h"
+#include "SampleApp/ConsolePrinter.h"
+#include "SampleApp/Endpointer.h"
+#include "SampleApp/InteractionManager.h"
+#include "SampleApp/PortAudioMicrophoneWrapper.h"
+#include "SampleApp/ShmAudioSource.h"
+#include "SampleApp/UIManager.h"
+
+#ifdef KWD_POCKETSPHINX
+#include "SampleApp/PocketsphinxKeywordDetector.h"
+#endif
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/// Class to manage the top-level components of the AVS Client Application
+class SampleApplication {
+public:
+    /**
+     * Create a SampleApplication.
+     *
+     * @return A new @c SampleApplication, or @c nullptr if the operation failed.
+     */
+    static std::unique_ptr<SampleApplication> create();
+
+    /// Runs the application, blocking until the keyword source stops.
+    void run();
+
+    /**
+     * Destructor. Stops the components that call into @c client or feed its stream before @c client goes.
+     */
+    ~SampleApplication();
+
+private:
+    /**
+     * Initialize a SampleApplication.
+     *
+     * @return @c true if initialization succeeded, else @c false.
+     */
+    bool initialize();
+
+    /**
+     * Creates the audio providers, the interaction manager and the endpointer on top of @c client and
+     * @c sharedDataStream, and in-process the keyword detector.
+     *
+     * @return @c true if all were created, else @c false.
+     */
+    bool paMicrophone();
+
+    /// The @c MediaPlayer used by @c SpeechSynthesizer.
+    std::shared_ptr<mediaPlayer::MediaPlayer> m_speakMediaPlayer;
+
+    /// The @c MediaPlayer used by @c AudioPlayer.
+    std::shared_ptr<mediaPlayer::MediaPlayer> m_audioMediaPlayer;
+
+    /// The @c MediaPlayer used by @c Alerts.
+    std::shared_ptr<mediaPlayer::MediaPlayer> m_alertsMediaPlayer;
+
+    /// The @c MediaPlayer used by @c NotificationsCapabilityAgent.
+    std::shared_ptr<mediaPlayer::MediaPlayer> m_notificationsMediaPlayer;
+
+    /// The format of the audio in @c sharedDataStream.
+    avsCommon::utils::AudioFormat compatibleAudioFormat;
+
+    /// The stream the microphone, or the recognizer's ring, writes to and requests are uploaded from.
+    std::shared_ptr<avsCommon::avs::AudioInputStream> sharedDataStream;
+
+    /// Records into @c sharedDataStream when no audio ring is configured.
+    std::shared_ptr<PortAudioMicrophoneWrapper> micWrapper;
+
+    /// Prints the dialog and connection state.
+    std::shared_ptr<UIManager> userInterfaceManager;
+
+    /// The SDK client.
+    std::shared_ptr<defaultClient::DefaultClient> client;
+
+    /// Starts and stops requests and changes the volume on behalf of the keywords.
+    std::shared_ptr<InteractionManager> interactionManager;
+
+    /// Feeds @c sharedDataStream from the recognizer's ring, when one is configured, in place of PortAudio.
+    std::unique_ptr<ShmAudioSource> m_shmAudioSource;
+
+    /// Handles wake words heard while Alexa is speaking.
+    std::shared_ptr<BargeInHandler> m_bargeInHandler;
+
+    /// Ends tap-to-talk requests when the user stops talking, or @c nullptr.
+    std::shared_ptr<Endpointer> m_endpointer;
+
+#ifdef KWD_POCKETSPHINX
+    /// Spots the keywords in @c sharedDataStream in-process.
+    std::unique_ptr<PocketsphinxKeywordDetector> m_keywordDetector;
+#endif
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_SAMPLEAPPLICATION_H_
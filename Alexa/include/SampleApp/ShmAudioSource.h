@@ -0,0 +1,126 @@
+/*
+ * ShmAudioSource.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_SHMAUDIOSOURCE_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_SHMAUDIOSOURCE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <sys/types.h>
+
+#include <AVSCommon/AVS/AudioInputStream.h>
+
+struct audio_ring_s;
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * Feeds the @c AudioInputStream from the recognizer's shared-memory audio ring instead of a microphone of its own.
+ * The recognizer is then the only process that opens the capture device. New samples are written into the stream
+ * directly from the mapped ring, and the reader thread sleeps on the ring's futex between frames. If the ring stays
+ * quiet for a second and the recognizer has meanwhile recreated it, the new ring is mapped in its place.
+ */
+class ShmAudioSource {
+public:
+    /**
+     * Maps the ring and starts the reader thread. Streaming starts off; see @c startStreamingMicrophoneData().
+     *
+     * @param name The POSIX shared-memory object the recognizer publishes to (its @c -shmring).
+     * @param stream The stream to write the audio to.
+     * @return A new @c ShmAudioSource, or @c nullptr if the ring does not exist or does not match the stream.
+     */
+    static std::unique_ptr<ShmAudioSource> create(
+        const std::string& name,
+        std::shared_ptr<avsCommon::avs::AudioInputStream> stream);
+
+    /**
+     * Starts writing the ring's audio into the stream.
+     *
+     * @return Whether streaming was started.
+     */
+    bool startStreamingMicrophoneData();
+
+    /**
+     * Stops writing into the stream. Audio published meanwhile is skipped, as a muted microphone would.
+     *
+     * @return Whether streaming was stopped.
+     */
+    bool stopStreamingMicrophoneData();
+
+    /**
+     * Destructor. Stops the reader thread and unmaps the ring.
+     */
+    ~ShmAudioSource();
+
+private:
+    /**
+     * Constructor.
+     *
+     * @param name The POSIX shared-memory object of the ring.
+     * @param stream The stream to write the audio to.
+     * @param writer The writer of @c stream.
+     * @param ring The mapped ring.
+     * @param inode The inode of @c ring's object.
+     */
+    ShmAudioSource(
+        const std::string& name,
+        std::shared_ptr<avsCommon::avs::AudioInputStream> stream,
+        std::shared_ptr<avsCommon::avs::AudioInputStream::Writer> writer,
+        audio_ring_s* ring,
+        ino_t inode);
+
+    /**
+     * Maps the ring again if @c m_name now names a different object. Called by the reader thread.
+     *
+     * @return Whether @c m_ring was replaced.
+     */
+    bool remapIfReplaced();
+
+    /// The body of the reader thread.
+    void readLoop();
+
+    /// The POSIX shared-memory object of the ring.
+    const std::string m_name;
+
+    /// The stream the audio is written to.
+    const std::shared_ptr<avsCommon::avs::AudioInputStream> m_stream;
+
+    /// The writer of @c m_stream.
+    const std::shared_ptr<avsCommon::avs::AudioInputStream::Writer> m_writer;
+
+    /// The mapped ring. Only the reader thread replaces it.
+    audio_ring_s* m_ring;
+
+    /// The inode of @c m_ring's object.
+    ino_t m_inode;
+
+    /// Whether new audio is written into the stream.
+    std::atomic<bool> m_isStreaming;
+
+    /// Whether the reader thread should exit.
+    std::atomic<bool> m_isShuttingDown;
+
+    /// The reader thread.
+    std::thread m_readThread;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_SHMAUDIOSOURCE_H_
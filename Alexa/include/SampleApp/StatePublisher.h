@@ -0,0 +1,106 @@
+/*
+ * StatePublisher.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *     http://aws.amazon.com/apache2.0/
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_STATEPUBLISHER_H_
+#define ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_STATEPUBLISHER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <AVSCommon/SDKInterfaces/ConnectionStatusObserverInterface.h>
+#include <AVSCommon/SDKInterfaces/DialogUXStateObserverInterface.h>
+
+namespace alexaClientSDK {
+namespace sampleApp {
+
+/**
+ * Carries the dialog and connection state from the SDK's observer callbacks to a worker thread, which reports it to
+ * the recognizer over the control channel and prints it. Publishing is an atomic store and an @c eventfd write, so an
+ * SDK thread never waits for a lock, a socket or the console. The worker only reports the latest state: one that is
+ * superseded before the worker wakes up is skipped, as the recognizer only acts on the current one.
+ */
+class StatePublisher {
+public:
+    /// The dialog states.
+    using DialogUXState = avsCommon::sdkInterfaces::DialogUXStateObserverInterface::DialogUXState;
+
+    /// The connection states.
+    using ConnectionStatus = avsCommon::sdkInterfaces::ConnectionStatusObserverInterface::Status;
+
+    /**
+     * Returns the process-wide publisher, starting its worker on first use.
+     *
+     * @return The @c StatePublisher singleton.
+     */
+    static StatePublisher& instance();
+
+    /**
+     * Publishes a new dialog state. Never blocks.
+     *
+     * @param state The new state.
+     */
+    void publishDialogState(DialogUXState state);
+
+    /**
+     * Publishes a new connection state. Never blocks.
+     *
+     * @param status The new state.
+     */
+    void publishConnectionStatus(ConnectionStatus status);
+
+    /**
+     * Destructor. Stops the worker.
+     */
+    ~StatePublisher();
+
+private:
+    /// Constructor.
+    StatePublisher();
+
+    /// Wakes the worker.
+    void notify();
+
+    /// The body of the worker thread.
+    void workLoop();
+
+    /**
+     * Reports a state to the recognizer and prints it.
+     *
+     * @param connectionStatus The connection state.
+     * @param dialogState The dialog state, if connected.
+     */
+    static void report(ConnectionStatus connectionStatus, DialogUXState dialogState);
+
+    /// The latest dialog state.
+    std::atomic<int> m_dialogState;
+
+    /// The latest connection state.
+    std::atomic<int> m_connectionStatus;
+
+    /// Whether the worker should exit.
+    std::atomic<bool> m_isShuttingDown;
+
+    /// The @c eventfd the worker sleeps on, or -1 if it could not be created.
+    int m_eventFd;
+
+    /// The worker thread.
+    std::thread m_worker;
+};
+
+}  // namespace sampleApp
+}  // namespace alexaClientSDK
+
+#endif  // ALEXA_CLIENT_SDK_SAMPLEAPP_INCLUDE_SAMPLEAPP_STATEPUBLISHER_H_
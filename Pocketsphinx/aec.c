@@ -0,0 +1,220 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * aec.c - Acoustic echo canceller for the captured microphone audio
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "aec.h"
+
+/* A reference whose peak stays below this (about -72 dBFS) is silence. */
+#define SILENT_LEVEL 8.0f
+/* Near-end talk when the microphone peaks above this share of the reference peak. */
+#define GEIGEL_RATIO 0.5f
+/* Blocks adaptation stays frozen after double talk was last seen. */
+#define DOUBLE_TALK_HOLD 5
+/* Regularization of the NLMS step, per tap (LSB^2). */
+#define STEP_FLOOR 100.0f
+
+struct aec_s {
+    int32 block;
+    int32 taps;
+    int32 hist;          /* Reference samples kept from earlier blocks: taps + delay - 1. */
+    float32 mu;
+    float32 *w;          /* Echo path, oldest tap first, so it lines up with x. */
+    float32 *x;          /* hist samples of history, then the current block. */
+    int32 hold;          /* Blocks left with adaptation frozen. */
+    float64 mic_energy;  /* Since the last aec_erle_db(). */
+    float64 out_energy;
+    uint64 blocks;
+    uint64 idle_blocks;
+    int32 quiet;         /* Reference samples since it was last above SILENT_LEVEL, up to hist. */
+};
+
+aec_t *
+aec_init(int32 block_samples, int32 samprate, int32 tail_ms, int32 delay_ms, float32 mu)
+{
+    aec_t *a = ckd_calloc(1, sizeof(*a));
+
+    a->block = block_samples;
+    a->taps = tail_ms * samprate / 1000;
+    if (a->taps < 1)
+        a->taps = 1;
+    a->hist = a->taps + delay_ms * samprate / 1000 - 1;
+    a->mu = mu;
+    a->w = ckd_calloc(a->taps, sizeof(float32));
+    a->x = ckd_calloc((size_t)a->hist + block_samples, sizeof(float32));
+    a->quiet = a->hist;
+
+    E_INFO("Echo canceller: %d taps after %d ms of delay, step %.2f\n", a->taps, delay_ms, mu);
+    return a;
+}
+
+/*
+ * The two kernels.  Each is one pass over contiguous floats with no
+ * aliasing, which gcc vectorizes at -O3 (float reductions need
+ * -funsafe-math-optimizations).
+ */
+static float32
+dot(float32 const *restrict w, float32 const *restrict x, int32 n)
+{
+    float32 sum = 0.0f;
+    int32 k;
+
+    for (k = 0; k < n; ++k)
+        sum += w[k] * x[k];
+    return sum;
+}
+
+/* Adapt w by g along x, and return the dot product of the new w with x_next. */
+static float32
+adapt_dot(float32 *restrict w, float32 const *restrict x, float32 const *restrict x_next,
+          float32 g, int32 n)
+{
+    float32 sum = 0.0f;
+    int32 k;
+
+    for (k = 0; k < n; ++k) {
+        w[k] += g * x[k];
+        sum += w[k] * x_next[k];
+    }
+    return sum;
+}
+
+/* Whether ref[0..n-1] is above silence. */
+static int
+ref_loud(int16 const *ref, int32 n)
+{
+    int32 j;
+
+    for (j = 0; j < n; ++j)
+        if (ref[j] >= SILENT_LEVEL || ref[j] <= -SILENT_LEVEL)
+            return TRUE;
+    return FALSE;
+}
+
+int
+aec_echo_expected(aec_t *a, int16 const *ref, int32 n)
+{
+    return a->quiet < a->hist || ref_loud(ref, n);
+}
+
+void
+aec_process(aec_t *a, int16 *mic, int16 const *ref, int32 n)
+{
+    float32 *x = a->x;
+    float32 xmax = 0.0f, dmax = 0.0f, power = 0.0f, y, e, g, v;
+    float64 mic_energy = 0.0, out_energy = 0.0;
+    int32 j, taps = a->taps;
+    uint8 adapt;
+
+    /* Longer buffers are cancelled a block at a time. */
+    while (n > a->block) {
+        aec_process(a, mic, ref, a->block);
+        mic += a->block;
+        ref += a->block;
+        n -= a->block;
+    }
+
+    for (j = 0; j < n; ++j)
+        x[a->hist + j] = ref[j];
+    ++a->blocks;
+    if (ref_loud(ref, n))
+        a->quiet = 0;
+    else if (a->quiet < a->hist)
+        a->quiet = a->quiet + n < a->hist ? a->quiet + n : a->hist;
+
+    /* Sample j of the block is predicted from x[j .. j + taps - 1]. */
+    for (j = 0; j < n + taps - 1; ++j)
+        xmax = fmaxf(xmax, fabsf(x[j]));
+    if (xmax < SILENT_LEVEL) {
+        /* Nothing is playing; whatever echo is left is below the noise. */
+        ++a->idle_blocks;
+        goto shift;
+    }
+
+    for (j = 0; j < n; ++j)
+        dmax = fmaxf(dmax, fabsf((float32)mic[j]));
+    if (dmax > GEIGEL_RATIO * xmax)
+        a->hold = DOUBLE_TALK_HOLD;
+    else if (a->hold > 0)
+        --a->hold;
+    adapt = a->hold == 0;
+
+    for (j = 0; j < taps; ++j)
+        power += x[j] * x[j];
+
+    y = dot(a->w, x, taps);
+    for (j = 0; j < n; ++j) {
+        e = mic[j] - y;
+        mic_energy += (float64)mic[j] * mic[j];
+        out_energy += (float64)e * e;
+        v = e < -32768.0f ? -32768.0f : (e > 32767.0f ? 32767.0f : e);
+        mic[j] = (int16)lrintf(v);
+
+        g = adapt ? a->mu * e / (power + STEP_FLOOR * taps) : 0.0f;
+        if (j + 1 < n) {
+            y = g != 0.0f ? adapt_dot(a->w, x + j, x + j + 1, g, taps)
+                : dot(a->w, x + j + 1, taps);
+            /* Slide the window's power by one sample; rounding must not take it below zero. */
+            power += x[j + taps] * x[j + taps] - x[j] * x[j];
+            if (power < 0.0f)
+                power = 0.0f;
+        }
+        else if (g != 0.0f) {
+            adapt_dot(a->w, x + j, x + j, g, taps);
+        }
+    }
+    a->mic_energy += mic_energy;
+    a->out_energy += out_energy;
+
+shift:
+    memmove(x, x + n, (size_t)a->hist * sizeof(float32));
+}
+
+float32
+aec_erle_db(aec_t *a)
+{
+    float32 erle = 0.0f;
+
+    if (a->out_energy > 0.0 && a->mic_energy > 0.0)
+        erle = (float32)(10.0 * log10(a->mic_energy / a->out_energy));
+    a->mic_energy = a->out_energy = 0.0;
+    return erle;
+}
+
+uint64
+aec_blocks(aec_t *a)
+{
+    return a->blocks;
+}
+
+uint64
+aec_idle_blocks(aec_t *a)
+{
+    return a->idle_blocks;
+}
+
+void
+aec_reset(aec_t *a)
+{
+    memset(a->w, 0, (size_t)a->taps * sizeof(float32));
+    memset(a->x, 0, ((size_t)a->hist + a->block) * sizeof(float32));
+    a->hold = 0;
+    a->quiet = a->hist;
+    a->mic_energy = a->out_energy = 0.0;
+}
+
+void
+aec_free(aec_t *a)
+{
+    if (a == NULL)
+        return;
+    ckd_free(a->w);
+    ckd_free(a->x);
+    ckd_free(a);
+}
@@ -0,0 +1,67 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * aec.h - Acoustic echo canceller for the captured microphone audio
+ *
+ * A normalized LMS filter models the path from the loudspeaker to the
+ * microphone and subtracts its estimate of the echo from every sample.
+ * The reference is what the SampleApp's media players render, captured
+ * back from an ALSA loopback of the playback device.  Adaptation freezes
+ * while the near end talks (Geigel double-talk detector), and frames are
+ * passed through untouched while the reference is silent, so an idle
+ * device pays next to nothing for it.
+ *
+ * The inner loops are plain float loops over contiguous arrays, written
+ * so that the compiler vectorizes them when built with the A113D profile
+ * flags (-O3 and NEON with -funsafe-math-optimizations, see README.md);
+ * at -Os they stay scalar.
+ */
+
+#ifndef __AEC_H__
+#define __AEC_H__
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct aec_s aec_t;
+
+/**
+ * Canceller for blocks of up to block_samples samples.  The echo path is
+ * modelled over tail_ms of reference audio, starting delay_ms after it
+ * (the playback buffer the loopback does not see).  mu is the NLMS step
+ * size, between 0 and 2; smaller converges slower but is steadier.
+ */
+aec_t *aec_init(int32 block_samples, int32 samprate, int32 tail_ms, int32 delay_ms, float32 mu);
+
+/**
+ * Cancel the echo of ref[0..n-1] from mic[0..n-1], in place.  Both must
+ * have been captured over the same period of time.
+ */
+void aec_process(aec_t *a, int16 *mic, int16 const *ref, int32 n);
+
+/**
+ * Whether the microphone may pick up echo while ref[0..n-1] plays: the
+ * reference is above silence now, or was recently enough for its echo to
+ * be within the modelled path.  Does not change the canceller's state.
+ */
+int aec_echo_expected(aec_t *a, int16 const *ref, int32 n);
+
+/** Echo return loss enhancement in dB over the frames with reference, since the last call. */
+float32 aec_erle_db(aec_t *a);
+
+/** Blocks processed and blocks passed through for a silent reference. */
+uint64 aec_blocks(aec_t *a);
+uint64 aec_idle_blocks(aec_t *a);
+
+/** Forget the echo path and the reference history, e.g. between unrelated recordings. */
+void aec_reset(aec_t *a);
+
+void aec_free(aec_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AEC_H__ */
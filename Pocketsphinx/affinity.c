@@ -0,0 +1,39 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * affinity.c - CPU pinning and scheduling of the recognizer's threads
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include <sphinxbase/err.h>
+
+#include "affinity.h"
+
+void
+affinity_setup(char const *name, int32 cpu, int32 rt_priority)
+{
+    int err;
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if ((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0)
+            E_WARN("Failed to pin %s thread to CPU %d: %s\n", name, cpu, strerror(err));
+        else
+            E_INFO("%s thread pinned to CPU %d\n", name, cpu);
+    }
+
+    if (rt_priority > 0) {
+        struct sched_param param;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = rt_priority;
+        if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0)
+            E_WARN("Failed to make %s thread SCHED_FIFO %d: %s\n", name, rt_priority, strerror(err));
+    }
+}
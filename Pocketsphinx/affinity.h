@@ -0,0 +1,26 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * affinity.h - CPU pinning and scheduling of the recognizer's threads
+ */
+
+#ifndef __AFFINITY_H__
+#define __AFFINITY_H__
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pin the calling thread to cpu, unless cpu is negative, and give it
+ * SCHED_FIFO priority rt_priority, unless that is 0.  Failures are logged
+ * and otherwise ignored, so an unprivileged run still works.
+ */
+void affinity_setup(char const *name, int32 cpu, int32 rt_priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AFFINITY_H__ */
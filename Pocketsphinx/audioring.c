@@ -0,0 +1,81 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * audioring.c - Writer side of the shared-memory audio ring
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <sphinxbase/err.h>
+
+#include "audioring.h"
+
+audio_ring_t *
+audio_ring_create(char const *name, uint32_t samprate, uint32_t capacity,
+                  uint32_t frame)
+{
+    audio_ring_t *r;
+    size_t bytes = audio_ring_bytes(capacity);
+    int fd;
+
+    /* A stale ring from a previous run would carry a stale write_pos. */
+    shm_unlink(name);
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644)) < 0) {
+        E_ERROR_SYSTEM("Failed to create shared memory %s", name);
+        return NULL;
+    }
+    if (ftruncate(fd, bytes) < 0) {
+        E_ERROR_SYSTEM("Failed to size shared memory %s", name);
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    r = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED) {
+        E_ERROR_SYSTEM("Failed to map shared memory %s", name);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    memset(r, 0, sizeof(*r));
+    r->samprate = samprate;
+    r->capacity = capacity;
+    r->frame = frame;
+    r->version = AUDIO_RING_VERSION;
+    /* Readers check the magic last, so they never see a half-built header. */
+    __atomic_store_n(&r->magic, AUDIO_RING_MAGIC, __ATOMIC_RELEASE);
+
+    E_INFO("Publishing audio in %s: %u samples\n", name, capacity);
+    return r;
+}
+
+int16_t *
+audio_ring_frame(audio_ring_t *r, uint32_t n)
+{
+    assert(n == r->frame && r->capacity % n == 0);
+    return audio_ring_samples(r) + r->write_pos % r->capacity;
+}
+
+void
+audio_ring_commit(audio_ring_t *r, uint32_t n, int64_t ns)
+{
+    __atomic_store_n(&r->write_ns, ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->write_pos, r->write_pos + n, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&r->seq, 1, __ATOMIC_RELEASE);
+    /* One syscall per frame; cheaper than tracking sleepers across processes. */
+    syscall(SYS_futex, &r->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+void
+audio_ring_destroy(audio_ring_t *r, char const *name)
+{
+    if (r == NULL)
+        return;
+    munmap(r, audio_ring_bytes(r->capacity));
+    shm_unlink(name);
+}
@@ -0,0 +1,116 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * audioring.h - Shared-memory audio ring between the recognizer and the
+ *               Alexa client
+ *
+ * With -shmring the recognizer is the only process that opens the
+ * microphone.  It captures each frame straight into a POSIX shared-memory
+ * ring and decodes it in place; the client maps the same ring read-only and
+ * writes new samples from it directly into its AudioInputStream.  Readers
+ * sleep on the futex word `seq`, which the writer bumps after every frame,
+ * so nobody polls and no device is handed back and forth.
+ *
+ * Only <stdint.h> types are used so that the client can include this header
+ * without sphinxbase.
+ */
+
+#ifndef __AUDIORING_H__
+#define __AUDIORING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_RING_MAGIC   0x41524e47 /* "ARNG" */
+#define AUDIO_RING_VERSION 2
+
+/* Default shared-memory object name. */
+#define AUDIO_RING_NAME    "/a113d-audio"
+
+typedef struct audio_ring_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t samprate;
+    uint32_t capacity;  /* Samples in the ring; the writer never wraps inside a frame. */
+    uint64_t write_pos; /* Samples written since creation.  Atomic. */
+    int64_t write_ns;   /* CLOCK_MONOTONIC time of the sample before write_pos.  Atomic. */
+    uint32_t seq;       /* Futex word, incremented after every commit.  Atomic. */
+    uint32_t frame;     /* Samples per commit.  The frame at write_pos is being
+                           overwritten, so readers have capacity - frame. */
+    /* int16_t samples[capacity] follow. */
+} audio_ring_t;
+
+static inline size_t
+audio_ring_bytes(uint32_t capacity)
+{
+    return sizeof(audio_ring_t) + (size_t)capacity * sizeof(int16_t);
+}
+
+static inline int16_t *
+audio_ring_samples(audio_ring_t *r)
+{
+    return (int16_t *)(r + 1);
+}
+
+static inline uint64_t
+audio_ring_write_pos(audio_ring_t *r)
+{
+    return __atomic_load_n(&r->write_pos, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t
+audio_ring_seq(audio_ring_t *r)
+{
+    return __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Sleep until the writer commits after `seq` was read, or timeout_ms
+ * passes.  Read seq before write_pos: if a commit lands in between, the
+ * futex value no longer matches and this returns at once.
+ */
+static inline void
+audio_ring_wait(audio_ring_t *r, uint32_t seq, int timeout_ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+    syscall(SYS_futex, &r->seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+}
+
+/*
+ * Writer side, in audioring.c.  The client only reads and does not link it.
+ */
+
+/**
+ * Create (or replace) the shared-memory object `name` holding a ring of
+ * `capacity` samples, which must be a multiple of `frame`, the samples
+ * passed to audio_ring_frame() and audio_ring_commit().  A replaced ring
+ * is a new object: readers of the old one see it go quiet and map the
+ * name again.  Returns NULL on failure.
+ */
+audio_ring_t *audio_ring_create(char const *name, uint32_t samprate, uint32_t capacity,
+                                uint32_t frame);
+
+/** Where the next n samples go.  Capture straight into it, then commit. */
+int16_t *audio_ring_frame(audio_ring_t *r, uint32_t n);
+
+/** Publish n samples written at audio_ring_frame(), the last captured at ns. */
+void audio_ring_commit(audio_ring_t *r, uint32_t n, int64_t ns);
+
+/** Unmap the ring and remove `name`. */
+void audio_ring_destroy(audio_ring_t *r, char const *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIORING_H__ */
@@ -0,0 +1,259 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * beamform.c - Delay-and-sum beamformer for a planar microphone array
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "beamform.h"
+
+/* Azimuths searched, 5 degrees apart. */
+#define N_AZIMUTHS 72
+/* Speed of sound in millimetres per second. */
+#define SOUND_MM_PER_S 343000.0f
+/* A frame this far above the noise floor can move the beam. */
+#define SPEECH_MARGIN_DB 6.0f
+/* How fast the noise floor rises towards louder background, per frame. */
+#define FLOOR_RISE 0.005f
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct beamform_s {
+    int32 n_mics;
+    int32 block;
+    int32 max_lag;       /* Largest delay between two microphones, in whole samples. */
+    int32 hist;          /* Samples kept from earlier blocks, per channel. */
+    float32 *delay;      /* N_AZIMUTHS x n_mics steering delays in samples, all >= 0. */
+    float32 *tdoa;       /* N_AZIMUTHS x n_pairs arrival differences in samples. */
+    int32 n_pairs;
+    float32 **x;         /* Per channel: hist samples of history, then the block. */
+    float32 **dx;        /* The same, first-differenced, for the correlations. */
+    float32 *cc;         /* n_pairs x (2 * max_lag + 1) cross-correlations. */
+    float32 *sum;        /* The steered block. */
+    float32 floor_db;
+    uint8 have_floor;
+    int32 doa;           /* Index into the azimuths, or -1. */
+    uint8 frozen;        /* Keep doa whatever the frames sound like. */
+};
+
+beamform_t *
+beamform_init(int32 n_mics, float32 const *pos_mm, int32 samprate, int32 block_samples)
+{
+    beamform_t *b = ckd_calloc(1, sizeof(*b));
+    float32 *arrival = ckd_calloc(n_mics, sizeof(float32));
+    float32 dist, max_dist = 0.0f, latest, theta;
+    int32 a, i, j, p;
+
+    b->n_mics = n_mics;
+    b->block = block_samples;
+    b->n_pairs = n_mics * (n_mics - 1) / 2;
+    b->doa = -1;
+
+    for (i = 0; i < n_mics; ++i)
+        for (j = i + 1; j < n_mics; ++j) {
+            dist = hypotf(pos_mm[2 * i] - pos_mm[2 * j], pos_mm[2 * i + 1] - pos_mm[2 * j + 1]);
+            if (dist > max_dist)
+                max_dist = dist;
+        }
+    b->max_lag = (int32)ceilf(max_dist / SOUND_MM_PER_S * samprate);
+    /* The correlations look max_lag back from a point max_lag into the past. */
+    b->hist = 2 * b->max_lag + 1;
+
+    /*
+     * A plane wave from azimuth theta reaches microphone i at
+     * -(p_i . u) / c relative to the origin.  Delaying every channel by
+     * the latest arrival minus its own lines them up.
+     */
+    b->delay = ckd_calloc((size_t)N_AZIMUTHS * n_mics, sizeof(float32));
+    b->tdoa = ckd_calloc((size_t)N_AZIMUTHS * (b->n_pairs ? b->n_pairs : 1), sizeof(float32));
+    for (a = 0; a < N_AZIMUTHS; ++a) {
+        theta = (float32)(2.0 * M_PI * a / N_AZIMUTHS);
+        latest = -1e9f;
+        for (i = 0; i < n_mics; ++i) {
+            arrival[i] = -(pos_mm[2 * i] * cosf(theta) + pos_mm[2 * i + 1] * sinf(theta))
+                / SOUND_MM_PER_S * samprate;
+            if (arrival[i] > latest)
+                latest = arrival[i];
+        }
+        for (i = 0; i < n_mics; ++i)
+            b->delay[a * n_mics + i] = latest - arrival[i];
+        for (i = 0, p = 0; i < n_mics; ++i)
+            for (j = i + 1; j < n_mics; ++j, ++p)
+                b->tdoa[a * b->n_pairs + p] = arrival[i] - arrival[j];
+    }
+    ckd_free(arrival);
+
+    b->x = ckd_calloc(n_mics, sizeof(float32 *));
+    b->dx = ckd_calloc(n_mics, sizeof(float32 *));
+    for (i = 0; i < n_mics; ++i) {
+        b->x[i] = ckd_calloc((size_t)b->hist + block_samples, sizeof(float32));
+        b->dx[i] = ckd_calloc((size_t)b->hist + block_samples, sizeof(float32));
+    }
+    b->cc = ckd_calloc((size_t)(b->n_pairs ? b->n_pairs : 1) * (2 * b->max_lag + 1), sizeof(float32));
+    b->sum = ckd_calloc(block_samples, sizeof(float32));
+
+    E_INFO("Beamformer: %d microphones, %.0f mm aperture, %d azimuths\n",
+           n_mics, max_dist, N_AZIMUTHS);
+    return b;
+}
+
+/* Correlation of a with b lagged by 0..n_lags-1 samples; plain loops gcc vectorizes at -O3. */
+static void
+correlate(float32 const *restrict a, float32 const *restrict b, float32 *restrict cc,
+          int32 n_lags, int32 n)
+{
+    float32 sum;
+    int32 l, t;
+
+    for (l = 0; l < n_lags; ++l) {
+        sum = 0.0f;
+        for (t = 0; t < n; ++t)
+            sum += a[t] * b[t - l];
+        cc[l] = sum;
+    }
+}
+
+/*
+ * Steered response power: for each azimuth, the pairs' correlations at
+ * the arrival differences that azimuth implies, interpolated between
+ * whole lags.  Returns the best azimuth, or -1 if nothing correlates.
+ */
+static int32
+estimate_doa(beamform_t *b, int32 n)
+{
+    int32 n_lags = 2 * b->max_lag + 1, a, i, j, p, l;
+    float32 power, best = 0.0f, lag, f, *cc;
+    int32 best_a = -1;
+
+    /*
+     * cc[l] is the correlation of channel i delayed by max_lag with
+     * channel j delayed by l, which peaks where i arrives l - max_lag
+     * samples after j.
+     */
+    for (i = 0, p = 0; i < b->n_mics; ++i)
+        for (j = i + 1; j < b->n_mics; ++j, ++p)
+            correlate(b->dx[i] + b->hist - b->max_lag, b->dx[j] + b->hist, b->cc + p * n_lags,
+                      n_lags, n);
+
+    for (a = 0; a < N_AZIMUTHS; ++a) {
+        power = 0.0f;
+        for (p = 0; p < b->n_pairs; ++p) {
+            cc = b->cc + p * n_lags;
+            lag = b->max_lag + b->tdoa[a * b->n_pairs + p];
+            lag = lag < 0.0f ? 0.0f : (lag > n_lags - 1 ? n_lags - 1 : lag);
+            l = (int32)lag;
+            f = lag - l;
+            power += l < n_lags - 1 ? (1.0f - f) * cc[l] + f * cc[l + 1] : cc[l];
+        }
+        if (power > best) {
+            best = power;
+            best_a = a;
+        }
+    }
+    return best_a;
+}
+
+void
+beamform_process(beamform_t *b, int16 const *in, int16 *out, int32 n)
+{
+    int32 i, t, m = b->n_mics, shift;
+    int64 energy = 0;
+    float32 energy_db, d, f, w0, w1, v, *x;
+
+    /* Longer buffers are steered a block at a time. */
+    while (n > b->block) {
+        beamform_process(b, in, out, b->block);
+        in += (size_t)b->block * m;
+        out += b->block;
+        n -= b->block;
+    }
+
+    for (i = 0; i < m; ++i) {
+        x = b->x[i] + b->hist;
+        for (t = 0; t < n; ++t)
+            x[t] = in[t * m + i];
+        for (t = 0; t < n; ++t)
+            b->dx[i][b->hist + t] = x[t] - x[t - 1];
+    }
+
+    for (t = 0; t < n; ++t)
+        energy += (int32)in[t * m] * in[t * m];
+    energy_db = 10.0f * log10f((float32)energy / (n > 0 ? n : 1) + 1.0f);
+    if (!b->have_floor || energy_db < b->floor_db) {
+        b->floor_db = energy_db;
+        b->have_floor = TRUE;
+    }
+    else {
+        b->floor_db += FLOOR_RISE * (energy_db - b->floor_db);
+    }
+    if (!b->frozen && b->max_lag > 0 && energy_db > b->floor_db + SPEECH_MARGIN_DB) {
+        int32 a = estimate_doa(b, n);
+        if (a >= 0)
+            b->doa = a;
+    }
+
+    /* Delay and sum towards the beam; straight ahead sum until speech was heard. */
+    memset(b->sum, 0, (size_t)n * sizeof(float32));
+    for (i = 0; i < m; ++i) {
+        d = b->doa >= 0 ? b->delay[b->doa * m + i] : 0.0f;
+        shift = (int32)d;
+        f = d - shift;
+        if (shift > b->hist - 1) {
+            shift = b->hist - 1;
+            f = 0.0f;
+        }
+        w0 = (1.0f - f) / m;
+        w1 = f / m;
+        x = b->x[i] + b->hist - shift;
+        for (t = 0; t < n; ++t)
+            b->sum[t] += w0 * x[t] + w1 * x[t - 1];
+    }
+    for (t = 0; t < n; ++t) {
+        v = b->sum[t];
+        v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+        out[t] = (int16)lrintf(v);
+    }
+
+    for (i = 0; i < m; ++i) {
+        memmove(b->x[i], b->x[i] + n, (size_t)b->hist * sizeof(float32));
+        memmove(b->dx[i], b->dx[i] + n, (size_t)b->hist * sizeof(float32));
+    }
+}
+
+void
+beamform_freeze(beamform_t *b, int frozen)
+{
+    b->frozen = frozen != 0;
+}
+
+int32
+beamform_doa(beamform_t *b)
+{
+    return b->doa < 0 ? -1 : b->doa * 360 / N_AZIMUTHS;
+}
+
+void
+beamform_free(beamform_t *b)
+{
+    int32 i;
+
+    if (b == NULL)
+        return;
+    for (i = 0; i < b->n_mics; ++i) {
+        ckd_free(b->x[i]);
+        ckd_free(b->dx[i]);
+    }
+    ckd_free(b->x);
+    ckd_free(b->dx);
+    ckd_free(b->delay);
+    ckd_free(b->tdoa);
+    ckd_free(b->cc);
+    ckd_free(b->sum);
+    ckd_free(b);
+}
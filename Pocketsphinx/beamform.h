@@ -0,0 +1,56 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * beamform.h - Delay-and-sum beamformer for a planar microphone array
+ *
+ * Turns the interleaved frames of an N-microphone array into one stream
+ * steered at the talker.  The direction of arrival is estimated on frames
+ * well above the noise floor, from the cross-correlations of all pairs of
+ * microphones (steered response power over 72 azimuths); in between, the
+ * beam stays where the last speech came from.  Each channel is delayed by
+ * its fractional offset for that azimuth (linear interpolation) and the
+ * channels are averaged, which keeps the far-field talker and attenuates
+ * diffuse noise and reverberation by up to 10*log10(N) dB.
+ *
+ * All per-sample work is plain float loops over contiguous arrays, so
+ * that the compiler vectorizes it with the A113D profile flags (see
+ * README.md), and the correlations only run on frames that can move the
+ * beam.
+ */
+
+#ifndef __BEAMFORM_H__
+#define __BEAMFORM_H__
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct beamform_s beamform_t;
+
+/**
+ * Beamformer for blocks of up to block_samples frames of n_mics channels.
+ * pos_mm holds the x and y of each microphone in millimetres, in channel
+ * order; azimuths are counted counterclockwise from the x axis.
+ */
+beamform_t *beamform_init(int32 n_mics, float32 const *pos_mm, int32 samprate, int32 block_samples);
+
+/** Steer n interleaved frames of in into the n samples of out. */
+void beamform_process(beamform_t *b, int16 const *in, int16 *out, int32 n);
+
+/**
+ * Hold the beam where it is (frozen non-zero) or let loud frames steer it
+ * again.  Frames are still steered and summed while it is frozen.
+ */
+void beamform_freeze(beamform_t *b, int frozen);
+
+/** Azimuth of the beam in degrees (0-359), or -1 until speech was heard. */
+int32 beamform_doa(beamform_t *b);
+
+void beamform_free(beamform_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BEAMFORM_H__ */
@@ -0,0 +1,255 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * capture.c - Event-driven audio capture for continuous.c
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <alsa/asoundlib.h>
+#else
+#include <sys/select.h>
+#include <sphinxbase/ad.h>
+#endif
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "capture.h"
+
+/* ALSA period in frames (10 ms at 16 kHz), and periods in the ring. */
+#define CAPTURE_PERIOD_FRAMES 160
+#define CAPTURE_PERIODS       16
+
+struct capture_s {
+#if defined(__linux__)
+    snd_pcm_t *pcm;
+#else
+    ad_rec_t *ad;
+#endif
+    int32 samprate;
+    int32 channels;
+    struct timespec start;   /* When the device started delivering. */
+    int64 delivered;         /* Samples returned or accounted as dropped. */
+    int64 dropped;
+    uint32 overruns;
+};
+
+static int64
+elapsed_samples(capture_t *cap)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64)(now.tv_sec - cap->start.tv_sec) * cap->samprate
+        + (int64)(now.tv_nsec - cap->start.tv_nsec) * cap->samprate / 1000000000;
+}
+
+/*
+ * An overrun discards whatever the device could not hold.  Estimate the
+ * loss from the wall clock: everything the device should have produced by
+ * now but that was never delivered.
+ */
+static void
+account_overrun(capture_t *cap)
+{
+    int64 lost;
+
+    ++cap->overruns;
+    lost = elapsed_samples(cap) - cap->delivered;
+    if (lost > 0) {
+        cap->dropped += lost;
+        cap->delivered += lost;
+    }
+    E_WARN("Audio overrun #%u, ~%lld samples dropped in total\n",
+           cap->overruns, (long long)cap->dropped);
+}
+
+#if defined(__linux__)
+
+capture_t *
+capture_open(const char *dev, int32 samprate, int32 channels)
+{
+    capture_t *cap;
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_uframes_t period = CAPTURE_PERIOD_FRAMES;
+    snd_pcm_uframes_t buffer = CAPTURE_PERIOD_FRAMES * CAPTURE_PERIODS;
+    unsigned int rate = samprate;
+    int err;
+
+    cap = ckd_calloc(1, sizeof(*cap));
+    cap->samprate = samprate;
+    cap->channels = channels;
+
+    if (dev == NULL)
+        dev = "default";
+    /* Blocking mode: snd_pcm_readi() sleeps in the driver until data is ready. */
+    if ((err = snd_pcm_open(&cap->pcm, dev, SND_PCM_STREAM_CAPTURE, 0)) < 0) {
+        E_ERROR("Failed to open '%s': %s\n", dev, snd_strerror(err));
+        ckd_free(cap);
+        return NULL;
+    }
+
+    snd_pcm_hw_params_alloca(&hw);
+    if ((err = snd_pcm_hw_params_any(cap->pcm, hw)) < 0
+        || (err = snd_pcm_hw_params_set_access(cap->pcm, hw,
+                                               SND_PCM_ACCESS_RW_INTERLEAVED)) < 0
+        || (err = snd_pcm_hw_params_set_format(cap->pcm, hw,
+                                               SND_PCM_FORMAT_S16_LE)) < 0
+        || (err = snd_pcm_hw_params_set_channels(cap->pcm, hw, channels)) < 0
+        || (err = snd_pcm_hw_params_set_rate_near(cap->pcm, hw, &rate, NULL)) < 0
+        || (err = snd_pcm_hw_params_set_period_size_near(cap->pcm, hw,
+                                                         &period, NULL)) < 0
+        || (err = snd_pcm_hw_params_set_buffer_size_near(cap->pcm, hw,
+                                                         &buffer)) < 0
+        || (err = snd_pcm_hw_params(cap->pcm, hw)) < 0) {
+        E_ERROR("Failed to configure '%s': %s\n", dev, snd_strerror(err));
+        snd_pcm_close(cap->pcm);
+        ckd_free(cap);
+        return NULL;
+    }
+    if (rate != (unsigned int)samprate) {
+        E_ERROR("'%s' does not support %d Hz (got %u)\n", dev, samprate, rate);
+        snd_pcm_close(cap->pcm);
+        ckd_free(cap);
+        return NULL;
+    }
+
+    if ((err = snd_pcm_start(cap->pcm)) < 0) {
+        E_ERROR("Failed to start '%s': %s\n", dev, snd_strerror(err));
+        snd_pcm_close(cap->pcm);
+        ckd_free(cap);
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &cap->start);
+    E_INFO("Capturing %d channels from '%s': period %lu, buffer %lu frames\n",
+           channels, dev, (unsigned long)period, (unsigned long)buffer);
+
+    return cap;
+}
+
+int32
+capture_read(capture_t *cap, int16 *buf, int32 n_samples)
+{
+    int32 got = 0;
+    snd_pcm_sframes_t k;
+
+    while (got < n_samples) {
+        k = snd_pcm_readi(cap->pcm, buf + (size_t)got * cap->channels, n_samples - got);
+        if (k > 0) {
+            got += k;
+            cap->delivered += k;
+        }
+        else if (k == -EPIPE) {
+            account_overrun(cap);
+            if (snd_pcm_prepare(cap->pcm) < 0 || snd_pcm_start(cap->pcm) < 0) {
+                E_ERROR("Failed to recover from overrun\n");
+                return -1;
+            }
+        }
+        else if (k == -ESTRPIPE) {
+            while ((k = snd_pcm_resume(cap->pcm)) == -EAGAIN)
+                snd_pcm_wait(cap->pcm, 100);
+            if (k < 0 && snd_pcm_prepare(cap->pcm) < 0) {
+                E_ERROR("Failed to resume capture\n");
+                return -1;
+            }
+        }
+        else if (k != -EAGAIN && k != -EINTR) {
+            E_ERROR("Failed to read audio: %s\n", snd_strerror(k));
+            return -1;
+        }
+    }
+
+    return got;
+}
+
+void
+capture_close(capture_t *cap)
+{
+    if (cap == NULL)
+        return;
+    snd_pcm_drop(cap->pcm);
+    snd_pcm_close(cap->pcm);
+    ckd_free(cap);
+}
+
+#else /* !__linux__ */
+
+capture_t *
+capture_open(const char *dev, int32 samprate, int32 channels)
+{
+    capture_t *cap;
+
+    if (channels != 1) {
+        E_ERROR("Only mono capture is supported on this platform\n");
+        return NULL;
+    }
+    cap = ckd_calloc(1, sizeof(*cap));
+    cap->samprate = samprate;
+    cap->channels = channels;
+    if ((cap->ad = ad_open_dev(dev, samprate)) == NULL) {
+        ckd_free(cap);
+        return NULL;
+    }
+    if (ad_start_rec(cap->ad) < 0) {
+        ad_close(cap->ad);
+        ckd_free(cap);
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &cap->start);
+
+    return cap;
+}
+
+int32
+capture_read(capture_t *cap, int16 *buf, int32 n_samples)
+{
+    int32 got = 0;
+    int32 k;
+    struct timeval tmo;
+
+    while (got < n_samples) {
+        if ((k = ad_read(cap->ad, buf + got, n_samples - got)) < 0)
+            return -1;
+        got += k;
+        cap->delivered += k;
+        if (got < n_samples) {
+            /* Sleep just long enough for the rest of the frame to arrive. */
+            tmo.tv_sec = 0;
+            tmo.tv_usec = (int64)(n_samples - got) * 1000000 / cap->samprate;
+            select(0, NULL, NULL, NULL, &tmo);
+        }
+    }
+    /* ad_read() hides overruns, so the clock is the only witness. */
+    if (elapsed_samples(cap) - cap->delivered > cap->samprate / 2)
+        account_overrun(cap);
+
+    return got;
+}
+
+void
+capture_close(capture_t *cap)
+{
+    if (cap == NULL)
+        return;
+    ad_stop_rec(cap->ad);
+    ad_close(cap->ad);
+    ckd_free(cap);
+}
+
+#endif /* !__linux__ */
+
+uint32
+capture_overruns(capture_t *cap)
+{
+    return cap->overruns;
+}
+
+int64
+capture_dropped(capture_t *cap)
+{
+    return cap->dropped;
+}
@@ -0,0 +1,57 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * capture.h - Event-driven audio capture for continuous.c
+ *
+ * capture_read() blocks until a full frame has arrived from the device, so
+ * the decoder runs at the audio rate instead of polling on a timer.  On
+ * Linux the ALSA device is opened in blocking mode and read directly; other
+ * platforms fall back to the sphinxbase ad_* library and sleep only for the
+ * time the missing samples take to arrive.
+ */
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct capture_s capture_t;
+
+/**
+ * Open and start the capture device.
+ *
+ * @param dev      device name, or NULL for the default device
+ * @param samprate sample rate in Hz
+ * @param channels channels per frame; more than one only on Linux
+ * @return the capture handle, or NULL on failure
+ */
+capture_t *capture_open(const char *dev, int32 samprate, int32 channels);
+
+/**
+ * Read exactly n_samples 16-bit samples per channel, interleaved, blocking
+ * until they arrive.
+ *
+ * Overruns are recovered from transparently and accounted for in
+ * capture_overruns() and capture_dropped().
+ *
+ * @return n_samples, or -1 on an unrecoverable device error
+ */
+int32 capture_read(capture_t *cap, int16 *buf, int32 n_samples);
+
+/** Number of overrun (xrun) events since capture_open(). */
+uint32 capture_overruns(capture_t *cap);
+
+/** Estimated number of samples lost to overruns since capture_open(). */
+int64 capture_dropped(capture_t *cap);
+
+/** Stop the device and free the handle. */
+void capture_close(capture_t *cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPTURE_H__ */
@@ -47,44 +47,46 @@
  * 
  * Remarks:
  *   - Each utterance is ended when a silence segment of at least 1 sec is recognized.
- *   - Single-threaded implementation for portability.
- *   - Uses audio library; can be replaced with an equivalent custom library.
+ *   - Capture, decoding and the handoff to the Alexa client run in separate
+ *     threads connected by bounded queues (see recognize_from_microphone()).
+ *   - Audio is captured through capture.c, which blocks until each frame
+ *     arrives instead of polling the device.
  */
 
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
+#include <time.h>
 
-#if defined(_WIN32) && !defined(__CYGWIN__)
-#include <windows.h>
-#else
-#include <sys/select.h>
-#endif
+#include <pthread.h>
 
 #include <sphinxbase/err.h>
-#include <sphinxbase/ad.h>
+#include <sphinxbase/ckd_alloc.h>
 
 #include "pocketsphinx.h"
+#include "capture.h"
+#include "latency.h"
+#include "keywords.h"
+#include "audioring.h"
+#include "spsc.h"
+#include "affinity.h"
+#include "pregate.h"
+#include "modelload.h"
+#include "reload.h"
+#include "ctlproto.h"
+#include "aec.h"
+#include "beamform.h"
 
 // 2018/05/04 Bling Added
 #include <stdlib.h>
 #include <errno.h>
+#include <poll.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
-
-struct snd_msgbuf {
-    long mtype;
-    char mtext[20];
-};
-
-struct rcv_msgbuf {
-    long mtype;
-    char mtext[20];
-};
+#include <sys/resource.h>
+#include <unistd.h>
 
 FILE *pFile;
-char pBuffer[20];
 // 2018/05/04 Bling Added
 
 static const arg_t cont_args_def[] = {
@@ -110,164 +112,1603 @@ static const arg_t cont_args_def[] = {
      ARG_BOOLEAN,
      "no",
      "Print word times in file transcription."},
+    {"-kwsmode",
+     ARG_BOOLEAN,
+     "yes",
+     "Spot the keywords with a streaming keyphrase search (default threshold -kws_threshold) "
+     "instead of decoding whole utterances."},
+    {"-latencylog",
+     ARG_STRING,
+     NULL,
+     "File to which per-stage latency percentiles are written periodically."},
+    {"-latencyperiod",
+     ARG_INTEGER,
+     "10",
+     "Seconds between writes of -latencylog and the CPU/pre-gate reports in the log."},
+    {"-shmring",
+     ARG_STRING,
+     NULL,
+     "Publish the captured audio in this POSIX shared-memory ring (e.g. " AUDIO_RING_NAME ") "
+     "for the Alexa client, which then does not open the microphone itself."},
+    {"-shmseconds",
+     ARG_INTEGER,
+     "10",
+     "Seconds of audio held in -shmring."},
+    {"-lowpower",
+     ARG_BOOLEAN,
+     "no",
+     "Cheaper acoustic scoring and pruning for always-on listening (sets -ds, -topn, "
+     "-maxhmmpf, -maxwpf, -pl_window, -fwdflat and -bestpath unless they are given)."},
+    {"-pregate",
+     ARG_BOOLEAN,
+     "no",
+     "Skip decoding of frames that the energy/zero-crossing pre-gate classifies as silence."},
+    {"-pregatemargin",
+     ARG_FLOAT32,
+     "9",
+     "dB above the adaptive noise floor at which the pre-gate passes a frame."},
+    {"-pregatelookback",
+     ARG_INTEGER,
+     "300",
+     "Milliseconds of skipped audio decoded first when the pre-gate opens."},
+    {"-pregatehangover",
+     ARG_INTEGER,
+     "1000",
+     "Milliseconds the pre-gate stays open after speech; keep it above -vad_postspeech."},
+    {"-micchannels",
+     ARG_INTEGER,
+     "1",
+     "Channels of -adcdev, one per microphone of the array; more than one are beamformed into one."},
+    {"-micpos",
+     ARG_STRING,
+     NULL,
+     "Positions of the microphones in channel order, as 'x,y' pairs in millimetres separated by "
+     "spaces; without it they are evenly spaced on a circle of -micradius."},
+    {"-micradius",
+     ARG_FLOAT32,
+     "35",
+     "Radius in millimetres of the circular array assumed without -micpos."},
+    {"-aecref",
+     ARG_STRING,
+     NULL,
+     "Capture device that records what the client plays (e.g. a loopback of the playback PCM); "
+     "its echo is cancelled from the microphone before decoding and before -shmring."},
+    {"-aectail",
+     ARG_INTEGER,
+     "64",
+     "Milliseconds of echo path modelled by the echo canceller."},
+    {"-aecdelay",
+     ARG_INTEGER,
+     "0",
+     "Milliseconds by which the echo at the microphone lags -aecref beyond -aectail's start, "
+     "e.g. the playback buffer."},
+    {"-aecmu",
+     ARG_FLOAT32,
+     "0.5",
+     "Step size of the echo canceller's NLMS filter (0-2)."},
+    {"-capturecpu",
+     ARG_INTEGER,
+     "-1",
+     "CPU to pin the capture thread to (-1: any)."},
+    {"-decodecpu",
+     ARG_INTEGER,
+     "-1",
+     "CPU to pin the decode thread to (-1: any)."},
+    {"-controlcpu",
+     ARG_INTEGER,
+     "-1",
+     "CPU to pin the control thread, which talks to the client, to (-1: any)."},
+    {"-capturepriority",
+     ARG_INTEGER,
+     "0",
+     "SCHED_FIFO priority of the capture thread (0: normal scheduling)."},
+    {"-keyword",
+     ARG_STRING,
+     NULL,
+     "Single keyword to spot instead of the keyword table."},
+    {"-kwstable",
+     ARG_STRING,
+     "/home/parallels/keywords.txt",
+     "Keyword table, one '<phrase> /<threshold>/ <action>' per line; "
+     "if missing, the last line of the corpus file is the only keyword."},
+    {"-verify",
+     ARG_BOOLEAN,
+     "no",
+     "Confirm each keyword spotted by the keyphrase search by decoding the audio before it with "
+     "the language model (-lm or -jsgf); the keywords must be in it."},
+    {"-verifyrelax",
+     ARG_FLOAT64,
+     "1e-5",
+     "With -verify, factor applied to the keyword thresholds of the first pass, so that it "
+     "misses fewer keywords and leaves the false ones to the second."},
+    {"-verifyms",
+     ARG_INTEGER,
+     "2000",
+     "With -verify, milliseconds of audio before the spotted keyword that are decoded again."},
+    {"-kwsholdms",
+     ARG_INTEGER,
+     "500",
+     "Milliseconds per word that a keyword which starts a longer keyword is held back, so that the "
+     "longer one can finish first."},
+    {"-bargein",
+     ARG_BOOLEAN,
+     "no",
+     "Keep spotting keywords while the client is speaking, not only while it is idle."},
+    {"-reload",
+     ARG_BOOLEAN,
+     "yes",
+     "Pick up changes to -kwstable and -dict while listening from the microphone."},
+    {"-lmcache",
+     ARG_STRING,
+     NULL,
+     "Directory in which a text -lm is kept converted to binary, which loads without parsing."},
+    {"-readahead",
+     ARG_BOOLEAN,
+     "yes",
+     "Start reading all model files into the page cache before initializing the decoder."},
+    {"-benchdir",
+     ARG_STRING,
+     NULL,
+     "Directory of audio files and labels.txt to benchmark detection on, faster than real time."},
+    {"-aecbench",
+     ARG_STRING,
+     NULL,
+     "Directory of microphone and reference recordings and pairs.txt to benchmark the echo canceller on."},
     CMDLN_EMPTY_OPTION
 };
 
+/* Samples handed to the decoder per capture_read() (20 ms at 16 kHz). */
+#define FRAME_SAMPLES 320
+
 static ps_decoder_t *ps;
 static cmd_ln_t *config;
 
-/* Sleep for specified msec */
-static void
-sleep_msec(int32 ms)
+/* Stages timed on the way from an audio frame to the client. */
+enum {
+    LAT_FRAME_DECODED,  /* frame arrival -> ps_process_raw() done, including the queue */
+    LAT_KEYWORD_DETECT, /* end of keyword -> hypothesis matched */
+    LAT_DETECT_SEND,    /* hypothesis matched -> keyword message sent */
+    LAT_KEYWORD_SEND,   /* end of keyword -> keyword message sent */
+    LAT_VERIFY,         /* -verify: second pass over the buffered audio */
+    LAT_STATE_DELIVERY, /* client sent its state -> received here */
+    LAT_BEAMFORM,       /* -micchannels: frame arrival -> beamformed */
+    LAT_AEC,            /* -aecref: frame arrival -> echo cancelled */
+    N_LAT_STAGES
+};
+
+static latency_hist_t latency[N_LAT_STAGES] = {
+    {"frame_to_decoded"},
+    {"keyword_to_detect"},
+    {"detect_to_send"},
+    {"keyword_to_send"},
+    {"verify"},
+    {"state_delivery"},
+    {"beamform"},
+    {"aec"},
+};
+
+/*
+ * Monotonic time at which the last word of the current hypothesis ended,
+ * given that the most recent frame arrived at frame_ns.  Frames are counted
+ * back from the end of the utterance because the front end drops silence
+ * frames, so frame numbers are not an offset into the captured audio.  The
+ * client uses this to start the Recognize stream right after the keyword.
+ */
+static int64
+keyword_end_ns(int64 frame_ns)
 {
-#if (defined(_WIN32) && !defined(GNUWINCE)) || defined(_WIN32_WCE)
-    Sleep(ms);
-#else
-    /* ------------------- Unix ------------------ */
-    struct timeval tmo;
+    ps_seg_t *seg;
+    char const *word;
+    int sf, ef, end = -1;
+    int32 frate = cmd_ln_int32_r(config, "-frate");
+    int n_frames = ps_get_n_frames(ps);
 
-    tmo.tv_sec = 0;
-    tmo.tv_usec = ms * 1000;
+    for (seg = ps_seg_iter(ps); seg; seg = ps_seg_next(seg)) {
+        word = ps_seg_word(seg);
+        /* Skip <s>, </s>, <sil> and [NOISE] fillers. */
+        if (word[0] == '<' || word[0] == '[')
+            continue;
+        ps_seg_frames(seg, &sf, &ef);
+        if (ef > end)
+            end = ef;
+    }
+    if (end < 0 || end >= n_frames)
+        return frame_ns;
 
-    select(0, NULL, NULL, NULL, &tmo);
-#endif
+    return frame_ns - (int64)(n_frames - 1 - end) * 1000000000 / frate;
 }
 
 /*
- * Main utterance processing loop:
- *     for (;;) {
- *        start utterance and wait for speech to process
- *        decoding till end-of-utterance silence will be detected
- *        print utterance result;
- *     }
+ * Hand a detected keyword to the Alexa client.  Never blocks: returns -1
+ * if the client did not get it (not running, or its socket is full).
  */
+static int
+send_keyword(int ctl_fd, uint32 seq, char const *hyp, int32 keyword_id,
+             int64 kwend_ns, int64 detect_ns, int32 doa)
+{
+    ctl_keyword_msg_t msg;
+    int64 sent_ns;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.kwend_ns = kwend_ns;
+    msg.detect_ns = detect_ns;
+    msg.keyword_id = keyword_id;
+    msg.doa_deg = (int16)doa;
+    strncpy(msg.phrase, hyp, sizeof(msg.phrase) - 1);
+    ctl_header_init(&msg.hdr, CTL_KEYWORD, seq);
+    if (ctl_send(ctl_fd, CTL_CLIENT_PATH, &msg, sizeof(msg)) < 0) {
+        E_ERROR_SYSTEM("Failed to send '%s' to the client", hyp);
+        return -1;
+    }
+
+    sent_ns = latency_now_ns();
+    latency_record(&latency[LAT_KEYWORD_DETECT], detect_ns - kwend_ns);
+    latency_record(&latency[LAT_DETECT_SEND], sent_ns - detect_ns);
+    latency_record(&latency[LAT_KEYWORD_SEND], sent_ns - kwend_ns);
+
+    printf("%s\n", hyp);
+    if (doa >= 0)
+        E_INFO("'%s' came from %d degrees\n", hyp, doa);
+    return 0;
+}
+
 static void
-recognize_from_microphone()
+print_word_times()
 {
-    ad_rec_t *ad;
-    int16 adbuf[2048];
-    uint8 utt_started, in_speech;
-    int32 k;
-    char const *hyp;
+    int frame_rate = cmd_ln_int32_r(config, "-frate");
+    ps_seg_t *iter = ps_seg_iter(ps);
+    while (iter != NULL) {
+        int32 sf, ef, pprob;
+        float conf;
 
-    // 2018/05/04 Bling Added
-    struct snd_msgbuf snd_buf;
-    struct rcv_msgbuf rcv_buf;
-    int snd_sqid, rcv_sqid;
-    key_t key;
-    int m_strlen;
-
-    // snd
-    if ((key = ftok("/home/parallels/corpus.txt", 66)) == -1) {
-        perror("ftok");
-        exit(1);
+        ps_seg_frames(iter, &sf, &ef);
+        pprob = ps_seg_prob(iter, NULL, NULL, NULL);
+        conf = logmath_exp(ps_get_logmath(ps), pprob);
+        printf("%s %.3f %.3f %f\n", ps_seg_word(iter), ((float)sf / frame_rate),
+               ((float) ef / frame_rate), conf);
+        iter = ps_seg_next(iter);
     }
+}
 
-    if ((snd_sqid = msgget(key, 0644 | IPC_CREAT)) == -1) {
-        perror("msgget");
-        exit(1);
+/*
+ * The keywords are -keyword if given, else the -kwstable table, else the
+ * last line of the corpus file that older clients match against.
+ */
+static keywords_t *
+load_keywords()
+{
+    float64 threshold = cmd_ln_float64_r(config, "-kws_threshold");
+    char const *keyword, *table;
+    keywords_t *kws;
+    char *line = NULL, *last = NULL;
+    size_t size = 0;
+
+    if ((keyword = cmd_ln_str_r(config, "-keyword")) != NULL) {
+        if ((kws = keywords_single(keyword, threshold)) == NULL)
+            E_FATAL("Invalid keyword '%s'\n", keyword);
+        return kws;
     }
 
-    snd_buf.mtype = 1;
+    table = cmd_ln_str_r(config, "-kwstable");
+    if (table && access(table, F_OK) == 0) {
+        if ((kws = keywords_load(table, threshold)) == NULL)
+            E_FATAL("Failed to load keyword table %s\n", table);
+        E_INFO("Loaded %d keywords from %s\n", kws->n_kw, table);
+        return kws;
+    }
 
     if ((pFile = fopen("/home/parallels/corpus.txt", "r")) == NULL) {
         perror("fopen");
         exit(1);
     }
 
-    while (fgets(pBuffer, 20, pFile) != NULL) {
+    /* getline() grows the buffer, so long phrases are not cut into pieces. */
+    while (getline(&line, &size, pFile) != -1) {
+        if (line[strspn(line, " \t\r\n")] != '\0') {
+            free(last);
+            last = strdup(line);
+        }
     }
-
+    free(line);
     fclose(pFile);
-    m_strlen = strlen(pBuffer) - 1;
 
-    // 2018/05/04 Bling Added
-    if (ps_start_utt(ps) < 0) {
+    if (last == NULL || (kws = keywords_single(last, threshold)) == NULL)
+        E_FATAL("No keyword in /home/parallels/corpus.txt\n");
+    free(last);
+
+    return kws;
+}
+
+/* Longest hypothesis kept for a detection. */
+#define MAX_HYP KEYWORD_MAX_LEN
+
+/*
+ * Keyword detection state.  The microphone, file and benchmark paths all
+ * feed their audio through detect_frame(), so offline runs measure exactly
+ * the decoding that happens on the device.
+ */
+typedef struct detect_s {
+    uint8 kws_mode;      /* Streaming keyphrase search instead of LM decoding. */
+    uint8 print_hyp;     /* LM mode: print every utterance hypothesis. */
+    uint8 print_times;   /* ... and its word times. */
+    uint8 utt_started;   /* LM mode: speech seen in the current utterance. */
+    keywords_t *kws;     /* The hypotheses that count as keywords. */
+    pregate_t *gate;     /* Skips silent frames, or NULL to decode them all. */
+    char const *kws_search; /* The active keyphrase search. */
+    char *verify_search; /* Search that confirms keywords, or NULL. */
+    int16 *hist;         /* Ring of the audio last decoded, for the verify pass. */
+    int32 hist_size;
+    int32 hist_pos;      /* Where the next sample goes. */
+    int32 hist_len;
+    int64 kwend_ns;      /* End of the last detected keyword. */
+    char hyp[MAX_HYP];   /* The last detected keyword. */
+    int64 hold_ns;       /* Hold per word a longer keyword adds. */
+    keyword_t const *held; /* Spotted keyword that starts a longer one, or NULL. */
+    int64 held_kwend_ns; /* Its end. */
+    int64 held_until;    /* When to report it if the longer one is not heard. */
+} detect_t;
+
+/*
+ * Keyphrase searches alternate between two names: ps_set_kws() frees a
+ * search it replaces, so the active one is never overwritten in place.
+ */
+static char const *const kws_search_names[2] = { "wakeup", "wakeup-next" };
+
+/*
+ * Build a keyphrase search for kws and switch to it, outside an utterance.
+ * The keyphrase search scores every keyword on every frame and reports it
+ * from ps_get_hyp() as soon as its score crosses the keyword's threshold,
+ * so there is no trailing silence to wait for.  On failure the current
+ * search stays active.
+ */
+static int
+detect_set_kws(detect_t *d, keywords_t *kws)
+{
+    char kws_path[] = "/tmp/continuous-kws-XXXXXX";
+    char const *name = kws_search_names[d->kws_search == kws_search_names[0]];
+    int fd, rv;
+
+    /* ps_set_kws() only reads keyword files, so write the table to one. */
+    if ((fd = mkstemp(kws_path)) < 0) {
+        E_ERROR_SYSTEM("Failed to create %s", kws_path);
+        return -1;
+    }
+    close(fd);
+    rv = keywords_write_kws(kws, kws_path,
+                            d->verify_search ? cmd_ln_float64_r(config, "-verifyrelax") : 1.0) < 0
+        || ps_set_kws(ps, name, kws_path) < 0
+        || ps_set_search(ps, name) < 0 ? -1 : 0;
+    unlink(kws_path);
+    if (rv == 0)
+        d->kws_search = name;
+    return rv;
+}
+
+static void
+detect_init(detect_t *d, keywords_t *kws, uint8 print_hyp)
+{
+    memset(d, 0, sizeof(*d));
+    d->kws_mode = cmd_ln_boolean_r(config, "-kwsmode");
+    d->print_hyp = print_hyp;
+    d->print_times = cmd_ln_boolean_r(config, "-time");
+    d->kws = kws;
+    d->hold_ns = (int64)cmd_ln_int32_r(config, "-kwsholdms") * 1000000;
+    if (cmd_ln_boolean_r(config, "-pregate"))
+        d->gate = pregate_init(FRAME_SAMPLES, (int32)cmd_ln_float32_r(config, "-samprate"),
+                               cmd_ln_float32_r(config, "-pregatemargin"),
+                               cmd_ln_int32_r(config, "-pregatelookback"),
+                               cmd_ln_int32_r(config, "-pregatehangover"));
+
+    if (d->kws_mode && cmd_ln_boolean_r(config, "-verify")) {
+        /* The search ps_init() set up from -lm or -jsgf. */
+        if (ps_get_search(ps) == NULL)
+            E_FATAL("-verify needs a language model (-lm) or grammar (-jsgf)\n");
+        d->verify_search = ckd_salloc(ps_get_search(ps));
+        d->hist_size = (int32)((int64)cmd_ln_int32_r(config, "-verifyms")
+                               * (int32)cmd_ln_float32_r(config, "-samprate") / 1000);
+        d->hist = ckd_calloc(d->hist_size, sizeof(int16));
+    }
+
+    if (d->kws_mode && detect_set_kws(d, kws) < 0)
+        E_FATAL("Failed to set up keyword search\n");
+
+    if (ps_start_utt(ps) < 0)
         E_FATAL("Failed to start utterance\n");
+}
+
+/* Start from a clean search so earlier audio cannot match. */
+static void
+detect_restart(detect_t *d)
+{
+    ps_end_utt(ps);
+    if (ps_start_utt(ps) < 0)
+        E_FATAL("Failed to start utterance\n");
+    d->utt_started = FALSE;
+    d->hist_len = 0;
+    d->held = NULL;
+    if (d->gate)
+        pregate_reset(d->gate);
+}
+
+/* Keep the audio about to be decoded for the verify pass. */
+static void
+detect_remember(detect_t *d, int16 const *buf, int32 n)
+{
+    int32 k;
+
+    if (n > d->hist_size) {
+        buf += n - d->hist_size;
+        n = d->hist_size;
+    }
+    d->hist_len = d->hist_len + n < d->hist_size ? d->hist_len + n : d->hist_size;
+    while (n > 0) {
+        k = d->hist_size - d->hist_pos;
+        if (k > n)
+            k = n;
+        memcpy(d->hist + d->hist_pos, buf, k * sizeof(int16));
+        d->hist_pos = (d->hist_pos + k) % d->hist_size;
+        buf += k;
+        n -= k;
     }
-    utt_started = FALSE;
+}
+
+/* Whether the words of phrase occur in hyp, in order and next to each other. */
+static int
+hyp_contains(char const *hyp, char const *phrase)
+{
+    size_t len = strlen(phrase);
+    char const *p;
+
+    for (p = strstr(hyp, phrase); p; p = strstr(p + 1, phrase)) {
+        if ((p == hyp || p[-1] == ' ') && (p[len] == '\0' || p[len] == ' '))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Second pass: decode the buffered audio up to the keyword d->hyp that the
+ * keyphrase search has just spotted, with the language model, and accept
+ * the keyword only if the LM hears it too.  Runs on the same decoder; the
+ * keyphrase search is reinstated with an open utterance.
+ */
+static int
+detect_verify(detect_t *d)
+{
+    int64 t0 = latency_now_ns();
+    int32 start = (d->hist_pos - d->hist_len + d->hist_size) % d->hist_size;
+    char const *hyp;
+    int ok;
+
+    ps_end_utt(ps);
+    if (ps_set_search(ps, d->verify_search) < 0 || ps_start_utt(ps) < 0)
+        E_FATAL("Failed to start verification\n");
+    if (start + d->hist_len > d->hist_size) {
+        ps_process_raw(ps, d->hist + start, d->hist_size - start, FALSE, FALSE);
+        ps_process_raw(ps, d->hist, d->hist_pos, FALSE, FALSE);
+    }
+    else {
+        ps_process_raw(ps, d->hist + start, d->hist_len, FALSE, FALSE);
+    }
+    ps_end_utt(ps);
+    hyp = ps_get_hyp(ps, NULL);
+    ok = hyp && hyp_contains(hyp, d->hyp);
+    if (!ok)
+        E_INFO("Rejected '%s', second pass heard '%s'\n", d->hyp, hyp ? hyp : "");
+
+    if (ps_set_search(ps, d->kws_search) < 0 || ps_start_utt(ps) < 0)
+        E_FATAL("Failed to restart keyword search\n");
+    latency_record(&latency[LAT_VERIFY], latency_now_ns() - t0);
+    return ok;
+}
+
+static char const *
+detect_found(detect_t *d, char const *hyp, int64 kwend_ns)
+{
+    d->kwend_ns = kwend_ns;
+    strncpy(d->hyp, hyp, sizeof(d->hyp) - 1);
+    d->hyp[sizeof(d->hyp) - 1] = '\0';
+    return d->hyp;
+}
+
+/*
+ * LM mode: finish the utterance and check whether it was the keyword.
+ */
+static char const *
+detect_end_utt(detect_t *d, int64 frame_ns)
+{
+    char const *hyp;
+    char const *found = NULL;
+
+    ps_end_utt(ps);
+    if ((hyp = ps_get_hyp(ps, NULL)) != NULL) {
+        // 2018/05/04 Bling Added
+        if (keywords_find(d->kws, hyp) != NULL)
+            found = detect_found(d, hyp, keyword_end_ns(frame_ns));
+        // 2018/05/04 Bling Added
+
+        if (d->print_hyp) {
+            printf("%s\n", hyp);
+            if (d->print_times)
+                print_word_times();
+        }
+    }
+    return found;
+}
+
+/*
+ * Keyphrase mode: the keyword the search spotted last.  When several
+ * keywords cross their thresholds before the search is restarted, the
+ * hypothesis joins them ("alexa alexa stop"), so look at the detections
+ * one by one and take the one that ended last, the longer phrase on a tie.
+ * Returns NULL if none of them is in the table.
+ */
+static keyword_t const *
+detect_last_keyword(detect_t *d)
+{
+    ps_seg_t *seg;
+    keyword_t const *kw, *last = NULL;
+    int sf, ef, last_ef = -1;
+
+    for (seg = ps_seg_iter(ps); seg; seg = ps_seg_next(seg)) {
+        if ((kw = keywords_find(d->kws, ps_seg_word(seg))) == NULL)
+            continue;
+        ps_seg_frames(seg, &sf, &ef);
+        if (ef > last_ef || (ef == last_ef && strlen(kw->phrase) > strlen(last->phrase))) {
+            last = kw;
+            last_ef = ef;
+        }
+    }
+    return last;
+}
+
+/*
+ * Keyphrase mode: report a spotted keyword, once the verify pass (if any)
+ * has confirmed it, and restart the search.
+ */
+static char const *
+detect_accept(detect_t *d, char const *hyp, int64 kwend_ns)
+{
+    char const *found = detect_found(d, hyp, kwend_ns);
+
+    if (d->verify_search && !detect_verify(d))
+        found = NULL;
+    /* Restart the search so that the keyword is not reported twice. */
+    detect_restart(d);
+    return found;
+}
+
+/* Keyphrase mode: the held keyword's time is up without the longer one. */
+static char const *
+detect_release(detect_t *d)
+{
+    return detect_accept(d, d->held->phrase, d->held_kwend_ns);
+}
+
+static char const *
+decode_frame(detect_t *d, int16 const *buf, int32 n, int64 frame_ns)
+{
+    char const *hyp;
+    char const *found;
+    keyword_t const *kw;
+    uint8 in_speech;
+
+    if (d->hist)
+        detect_remember(d, buf, n);
+    ps_process_raw(ps, buf, n, FALSE, FALSE);
+
+    if (d->kws_mode) {
+        if ((hyp = ps_get_hyp(ps, NULL)) == NULL)
+            return NULL;
+        if ((kw = detect_last_keyword(d)) == NULL) {
+            E_WARN("Keyphrase search reported '%s', which has no keyword\n", hyp);
+            detect_restart(d);
+            return NULL;
+        }
+        if (kw == d->held)
+            return NULL;
+        if (kw->longer_words > 0) {
+            /* Keep searching: the keyword may be the start of a longer one. */
+            d->held = kw;
+            d->held_kwend_ns = keyword_end_ns(frame_ns);
+            d->held_until = d->held_kwend_ns + kw->longer_words * d->hold_ns;
+            return NULL;
+        }
+        return detect_accept(d, kw->phrase, keyword_end_ns(frame_ns));
+    }
+
+    in_speech = ps_get_in_speech(ps);
+    if (in_speech && !d->utt_started) {
+        d->utt_started = TRUE;
+        E_INFO("Listening...\n");
+    }
+    if (in_speech || !d->utt_started)
+        return NULL;
+
+    /* speech -> silence transition, time to start new utterance  */
+    found = detect_end_utt(d, frame_ns);
+    if (ps_start_utt(ps) < 0)
+        E_FATAL("Failed to start utterance\n");
+    d->utt_started = FALSE;
     E_INFO("Ready....\n");
+    return found;
+}
+
+/*
+ * Decode one frame whose last sample was captured at frame_ns.  Returns
+ * the keyword if this frame completed a detection, else NULL; the search
+ * has then been restarted and d->kwend_ns holds the end of the keyword.
+ * With the pre-gate, silent frames are not decoded at all, and when speech
+ * starts the skipped frames just before it are decoded first.
+ */
+static char const *
+detect_frame(detect_t *d, int16 const *buf, int32 n, int64 frame_ns)
+{
+    char const *found = NULL;
+    int16 const *lb_buf;
+    int32 lb_n, i;
+    int64 lb_ns;
+
+    /* Checked before the pre-gate, which skips the silence after a held keyword. */
+    if (d->held && frame_ns >= d->held_until)
+        return detect_release(d);
+    if (d->gate == NULL)
+        return decode_frame(d, buf, n, frame_ns);
+
+    switch (pregate_frame(d->gate, buf, n, frame_ns)) {
+    case PREGATE_SKIP:
+        return NULL;
+    case PREGATE_ONSET:
+        for (i = 0; pregate_lookback(d->gate, i, &lb_buf, &lb_n, &lb_ns) == 0; ++i) {
+            if (found == NULL)
+                found = decode_frame(d, lb_buf, lb_n, lb_ns);
+        }
+        break;
+    case PREGATE_PASS:
+        break;
+    }
+    if (found == NULL)
+        found = decode_frame(d, buf, n, frame_ns);
+    return found;
+}
+
+/*
+ * End of input: decode the speech still pending in LM mode, or report the
+ * keyword held in keyphrase mode.  Leaves no utterance open.
+ */
+static char const *
+detect_finish(detect_t *d, int64 frame_ns)
+{
+    char const *found = NULL;
+
+    if (!d->kws_mode && d->utt_started)
+        found = detect_end_utt(d, frame_ns);
+    else {
+        /* The audio ended while a keyword was held; nothing longer can follow. */
+        if (d->held)
+            found = detect_release(d);
+        ps_end_utt(ps);
+    }
+    d->utt_started = FALSE;
+    return found;
+}
+
+/*
+ * Swap in a reloaded dictionary and/or keyword table between utterances.
+ * The decoder and its models stay loaded; only the dictionary and the
+ * searches are rebuilt.  Whatever fails to load leaves the old one in use.
+ */
+static void
+detect_reload(detect_t *d, keywords_t *kws, int dict_changed)
+{
+    ps_end_utt(ps);
+    if (dict_changed && ps_load_dict(ps, cmd_ln_str_r(config, "-dict"), NULL, NULL) < 0)
+        E_ERROR("Failed to reload the dictionary\n");
+    if (kws) {
+        if (d->kws_mode && detect_set_kws(d, kws) < 0) {
+            E_ERROR("Keeping the current keywords; are all their words in the dictionary?\n");
+            keywords_free(kws);
+        }
+        else {
+            keywords_free(d->kws);
+            d->kws = kws;
+            d->held = NULL;
+        }
+    }
+    if (ps_start_utt(ps) < 0)
+        E_FATAL("Failed to start utterance\n");
+    d->utt_started = FALSE;
+}
+
+/* Frames queued between the capture and decode threads (1.28 s). */
+#define FRAME_QUEUE 64
+
+/* A captured frame on its way from the capture to the decode thread. */
+typedef struct frame_msg_s {
+    int16 *samples;
+    int32 n;
+    int64 ns;                /* When its last sample was captured. */
+    int32 doa;               /* Azimuth of the beam in degrees, -1 without an array. */
+} frame_msg_t;
+
+/*
+ * Decoding is gated while the client handles a request.  The control
+ * thread opens and closes the gate as the client reports its state; the
+ * decode thread closes it on a detection and completes an opening with a
+ * compare-and-swap, so it never undoes a close.
+ */
+enum {
+    GATE_CLOSED,             /* Drop frames. */
+    GATE_OPENING,            /* Client takes keywords; restart the search, then decode. */
+    GATE_OPEN
+};
+
+typedef struct mic_s {
+    capture_t *cap;
+    beamform_t *beam;        /* With a microphone array; capture thread only. */
+    int16 *multi;            /* One interleaved frame of the array. */
+    capture_t *ref_cap;      /* Echo reference, or NULL. */
+    aec_t *aec;              /* Capture thread only. */
+    int16 *ref_buf;
+    audio_ring_t *ring;      /* Shared ring the frames are captured into, or NULL. */
+    int16 *pool;             /* Private frames when there is no ring. */
+    uint32 n_pool;
+    spsc_t *frames;          /* capture -> decode */
+    int ctl_fd;              /* Control socket; decode sends, control receives. */
+    uint32 kw_seq;           /* Sequence number of the last keyword sent.  Atomic. */
+    detect_t det;            /* Decode thread only. */
+    reload_t *reload;        /* Watches the keyword table and dictionary, or NULL. */
+    int gate;                /* Atomic. */
+    char const *latency_log;
+    int64 latency_period_ns;
+} mic_t;
+
+/* Echo canceller for FRAME_SAMPLES frames, as configured by -aectail, -aecdelay and -aecmu. */
+static aec_t *
+aec_from_config(int32 samprate)
+{
+    return aec_init(FRAME_SAMPLES, samprate, cmd_ln_int32_r(config, "-aectail"),
+                    cmd_ln_int32_r(config, "-aecdelay"), cmd_ln_float32_r(config, "-aecmu"));
+}
+
+/*
+ * Beamformer for the -micchannels microphones at -micpos (or on a circle
+ * of -micradius), or NULL for a single microphone.
+ */
+static beamform_t *
+beamform_from_config(int32 samprate)
+{
+    int32 n_mics = cmd_ln_int32_r(config, "-micchannels");
+    char const *spec = cmd_ln_str_r(config, "-micpos");
+    float32 *pos, radius = cmd_ln_float32_r(config, "-micradius");
+    beamform_t *b;
+    int32 i, used;
+
+    if (n_mics <= 1)
+        return NULL;
+    pos = ckd_calloc(2 * n_mics, sizeof(float32));
+    for (i = 0; i < n_mics; ++i) {
+        if (spec == NULL) {
+            pos[2 * i] = radius * cosf(2.0f * (float32)M_PI * i / n_mics);
+            pos[2 * i + 1] = radius * sinf(2.0f * (float32)M_PI * i / n_mics);
+        }
+        else if (sscanf(spec, " %f , %f%n", &pos[2 * i], &pos[2 * i + 1], &used) == 2) {
+            spec += used;
+        }
+        else {
+            E_FATAL("-micpos needs 'x,y' for each of the %d microphones\n", n_mics);
+        }
+    }
+    b = beamform_init(n_mics, pos, samprate, FRAME_SAMPLES);
+    ckd_free(pos);
+    return b;
+}
+
+/*
+ * Capture thread: read the device and hand each frame on.  It never waits
+ * for the decoder, so a slow frame costs the decoder that frame rather
+ * than the device an overrun (and the shared ring keeps receiving audio).
+ */
+static void *
+capture_thread(void *arg)
+{
+    mic_t *m = arg;
+    frame_msg_t msg;
+    uint32 seq = 0, dropped = 0;
+    int64 report_ns = latency_now_ns();
+    uint64 blocks = 0, idle_blocks = 0;
+
+    affinity_setup("capture", cmd_ln_int32_r(config, "-capturecpu"),
+                   cmd_ln_int32_r(config, "-capturepriority"));
 
     for (;;) {
-        if (!strcmp(rcv_buf.mtext, "OK")) {
-            if ((k = ad_read(ad, adbuf, 2048)) < 0) {
-                E_FATAL("Failed to read audio\n");
+        /*
+         * A private frame is only reused once the decoder has taken the
+         * frames after it, since seq advances only when a push succeeds
+         * and the pool is two frames larger than the queue.
+         */
+        msg.samples = m->ring ? audio_ring_frame(m->ring, FRAME_SAMPLES)
+            : m->pool + (size_t)(seq % m->n_pool) * FRAME_SAMPLES;
+        /* Blocks until a full frame has arrived; no polling delay. */
+        if ((msg.n = capture_read(m->cap, m->beam ? m->multi : msg.samples, FRAME_SAMPLES)) < 0) {
+            E_FATAL("Failed to read audio\n");
+        }
+        msg.ns = latency_now_ns();
+        msg.doa = -1;
+        /* The reference device runs on the same period, so its frame is already there. */
+        if (m->aec && capture_read(m->ref_cap, m->ref_buf, msg.n) < 0)
+            E_FATAL("Failed to read the echo reference\n");
+        if (m->beam) {
+            /*
+             * Loudspeaker echo is loud and comes from the speaker's
+             * direction, so the beam is not steered while it can be heard.
+             */
+            if (m->aec)
+                beamform_freeze(m->beam, aec_echo_expected(m->aec, m->ref_buf, msg.n));
+            beamform_process(m->beam, m->multi, msg.samples, msg.n);
+            msg.doa = beamform_doa(m->beam);
+            latency_record(&latency[LAT_BEAMFORM], latency_now_ns() - msg.ns);
+        }
+        /*
+         * Cancel the echo in place, before the frame is published, so the
+         * decoder and the client both get the cleaned audio.
+         */
+        if (m->aec) {
+            aec_process(m->aec, msg.samples, m->ref_buf, msg.n);
+            latency_record(&latency[LAT_AEC], latency_now_ns() - msg.ns);
+            if (msg.ns >= report_ns + m->latency_period_ns) {
+                uint64 n = aec_blocks(m->aec) - blocks;
+                E_INFO("Echo canceller: ERLE %.1f dB, reference silent in %.1f%% of frames\n",
+                       aec_erle_db(m->aec),
+                       n ? 100.0 * (aec_idle_blocks(m->aec) - idle_blocks) / n : 0.0);
+                blocks = aec_blocks(m->aec);
+                idle_blocks = aec_idle_blocks(m->aec);
+                report_ns = msg.ns;
             }
-            ps_process_raw(ps, adbuf, k, FALSE, FALSE);
-            in_speech = ps_get_in_speech(ps);
-        } else {
-            // rcv
-            if ((key = ftok("/home/parallels/a113d.txt", 66)) == -1) {
-                perror("ftok");
-                exit(1);
+        }
+        if (m->ring)
+            audio_ring_commit(m->ring, msg.n, msg.ns);
+
+        if (spsc_push(m->frames, &msg) == 0)
+            ++seq;
+        else if (dropped++ % 50 == 0)
+            E_WARN("Decoder is behind, %u frames not decoded\n", dropped);
+    }
+    return NULL;
+}
+
+/* CPU time of the process and of the decode thread at the last report. */
+typedef struct cpu_usage_s {
+    int64 wall_ns;
+    int64 process_ns;
+    int64 decode_ns;
+    uint64 frames;
+    uint64 skipped;
+} cpu_usage_t;
+
+static int64
+cpu_clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (int64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Called from the decode thread, whose CPU time it measures. */
+static void
+cpu_usage_sample(cpu_usage_t *u)
+{
+    u->wall_ns = latency_now_ns();
+    u->process_ns = cpu_clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    u->decode_ns = cpu_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/*
+ * Log the CPU share of the process and of the decode thread since the last
+ * report, and how many frames the pre-gate kept from the decoder.  Idle CPU
+ * is what the always-on power draw follows.
+ */
+static void
+cpu_usage_report(cpu_usage_t *u, pregate_t *gate)
+{
+    cpu_usage_t prev = *u;
+    double wall_ns;
+    uint64 frames, skipped;
+
+    cpu_usage_sample(u);
+    wall_ns = (double)(u->wall_ns - prev.wall_ns);
+    if (wall_ns <= 0)
+        return;
+    if (gate) {
+        u->frames = pregate_frames(gate);
+        u->skipped = pregate_skipped(gate);
+    }
+    frames = u->frames - prev.frames;
+    skipped = u->skipped - prev.skipped;
+    E_INFO("CPU %.1f%% (decoder %.1f%%), pre-gate skipped %.1f%% of %llu frames\n",
+           100.0 * (u->process_ns - prev.process_ns) / wall_ns,
+           100.0 * (u->decode_ns - prev.decode_ns) / wall_ns,
+           frames ? 100.0 * skipped / frames : 0.0, (unsigned long long)frames);
+}
+
+/*
+ * Decode thread: run the frames through the keyword search while the gate
+ * is open, and send detections to the client.
+ */
+static void *
+decode_thread(void *arg)
+{
+    mic_t *m = arg;
+    frame_msg_t f;
+    char const *hyp;
+    keyword_t const *kw;
+    int gate;
+    uint32 seq;
+    int64 report_ns = latency_now_ns();
+    cpu_usage_t cpu = {0};
+    uint8 flushed = FALSE;
+
+    affinity_setup("decode", cmd_ln_int32_r(config, "-decodecpu"), 0);
+    cpu_usage_sample(&cpu);
+
+    for (;;) {
+        spsc_pop(m->frames, &f);
+
+        /* Stages recorded by the control and capture threads may be read mid-update; it is only a report. */
+        if (f.ns >= report_ns + m->latency_period_ns) {
+            if (m->latency_log)
+                latency_dump_file(m->latency_log, latency, N_LAT_STAGES);
+            cpu_usage_report(&cpu, m->det.gate);
+            fflush(stdout);
+            report_ns = f.ns;
+        }
+
+        switch (gate = __atomic_load_n(&m->gate, __ATOMIC_ACQUIRE)) {
+        case GATE_CLOSED:
+            /* Nothing is decoded until the client is idle again, so write out the hypotheses now. */
+            if (!flushed) {
+                fflush(stdout);
+                flushed = TRUE;
             }
+            continue;
+        case GATE_OPENING:
+            /* Start from a clean search so audio from before the gate cannot match. */
+            detect_restart(&m->det);
+            if (!__atomic_compare_exchange_n(&m->gate, &gate, GATE_OPEN, FALSE,
+                                             __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                continue;
+            flushed = FALSE;
+            break;
+        }
+
+        /* Between utterances (always, for the keyphrase search), swap in edited keywords. */
+        if (m->reload && reload_pending(m->reload) && !m->det.utt_started) {
+            keywords_t *kws;
+            int dict_changed;
+
+            kws = reload_take(m->reload, &dict_changed);
+            detect_reload(&m->det, kws, dict_changed);
+        }
+
+        hyp = detect_frame(&m->det, f.samples, f.n, f.ns);
+        latency_record(&latency[LAT_FRAME_DECODED], latency_now_ns() - f.ns);
+        if (hyp == NULL)
+            continue;
+
+        /* Closed until the client reports idle after acting on this keyword. */
+        __atomic_store_n(&m->gate, GATE_CLOSED, __ATOMIC_RELEASE);
+        seq = __atomic_add_fetch(&m->kw_seq, 1, __ATOMIC_ACQ_REL);
+        kw = keywords_find(m->det.kws, hyp);
+        if (send_keyword(m->ctl_fd, seq, hyp, kw ? (int32)(kw - m->det.kws->kw) : -1,
+                         m->det.kwend_ns, latency_now_ns(), f.doa) < 0) {
+            /*
+             * Nothing will acknowledge a keyword the client never got, so
+             * take its number back and listen again rather than stay
+             * closed until the client next reports idle.
+             */
+            __atomic_compare_exchange_n(&m->kw_seq, &seq, seq - 1, FALSE,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            gate = GATE_CLOSED;
+            __atomic_compare_exchange_n(&m->gate, &gate, GATE_OPENING, FALSE,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Main utterance processing:
+ *     open the audio device (and the shared audio ring) once
+ *     capture thread: read frames and queue them for decoding
+ *     decode thread: decode till the keyword (or end-of-utterance silence)
+ *         is detected, send it to the client and gate decoding
+ *     control thread (this one): follow the client's dialog state and open
+ *         the gate while it is idle (with -bargein, also while it responds)
+ * Capture and decode are connected by a bounded SPSC queue and the client
+ * by non-blocking datagrams (ctlproto.h), so neither the client nor a slow
+ * decode can hold up capture.
+ */
+static void
+recognize_from_microphone()
+{
+    static mic_t m;
+    char const *ring_name;
+    int32 samprate = (int32)cmd_ln_float32_r(config, "-samprate");
+    pthread_t capture_tid, decode_tid;
+    struct pollfd pfd;
+    ctl_msg_t msg;
+    ctl_header_t hello;
+    uint32 kw_seq;
+    int type, barge_in = cmd_ln_boolean_r(config, "-bargein");
+
+    if ((m.ctl_fd = ctl_open(CTL_RECOGNIZER_PATH)) < 0)
+        E_FATAL_SYSTEM("Failed to bind %s", CTL_RECOGNIZER_PATH);
+
+    detect_init(&m.det, load_keywords(), TRUE);
+    // 2018/05/04 Bling Added
+    if (cmd_ln_boolean_r(config, "-reload"))
+        m.reload = reload_start(cmd_ln_str_r(config, "-keyword") ? NULL : cmd_ln_str_r(config, "-kwstable"),
+                                cmd_ln_str_r(config, "-dict"),
+                                cmd_ln_float64_r(config, "-kws_threshold"));
+
+    /*
+     * The device stays open and streaming for the life of the process;
+     * reopening it costs hundreds of milliseconds and loses the first
+     * frames.  Without -shmring it has to be a shareable PCM (e.g. dsnoop)
+     * since the client captures from it at the same time.
+     */
+    if ((m.cap = capture_open(cmd_ln_str_r(config, "-adcdev"), samprate,
+                              cmd_ln_int32_r(config, "-micchannels"))) == NULL) {
+        E_FATAL("Failed to open audio device\n");
+    }
+    if ((m.beam = beamform_from_config(samprate)) != NULL)
+        m.multi = ckd_calloc((size_t)FRAME_SAMPLES * cmd_ln_int32_r(config, "-micchannels"), sizeof(int16));
+    if (cmd_ln_str_r(config, "-aecref") != NULL) {
+        if ((m.ref_cap = capture_open(cmd_ln_str_r(config, "-aecref"), samprate, 1)) == NULL)
+            E_FATAL("Failed to open echo reference device %s\n", cmd_ln_str_r(config, "-aecref"));
+        m.aec = aec_from_config(samprate);
+        m.ref_buf = ckd_calloc(FRAME_SAMPLES, sizeof(int16));
+    }
+
+    /*
+     * With a shared ring the client reads our capture instead of opening
+     * the device itself.  Frames are captured straight into the ring and
+     * decoded from there, so no sample is copied on this side.
+     */
+    if ((ring_name = cmd_ln_str_r(config, "-shmring")) != NULL) {
+        uint32 frames = (uint32)cmd_ln_int32_r(config, "-shmseconds") * samprate / FRAME_SAMPLES;
+        if (frames < 2 * FRAME_QUEUE)
+            frames = 2 * FRAME_QUEUE;
+        if ((m.ring = audio_ring_create(ring_name, samprate, frames * FRAME_SAMPLES, FRAME_SAMPLES)) == NULL)
+            E_FATAL("Failed to create audio ring %s\n", ring_name);
+    }
+
+    m.frames = spsc_init(FRAME_QUEUE, sizeof(frame_msg_t));
+    if (m.ring == NULL) {
+        m.n_pool = m.frames->size + 2;
+        m.pool = ckd_calloc((size_t)m.n_pool * FRAME_SAMPLES, sizeof(int16));
+    }
+
+    /*
+     * Hypotheses are printed from the decoding thread; a write per line
+     * would stall it, so stdout is flushed only while decoding is gated
+     * and on each -latencyperiod report.
+     */
+    setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+
+    m.latency_log = cmd_ln_str_r(config, "-latencylog");
+    m.latency_period_ns = (int64)cmd_ln_int32_r(config, "-latencyperiod") * 1000000000;
 
-            if ((rcv_sqid = msgget(key, 0644 | IPC_CREAT)) == -1) {
-                perror("msgget");
-                exit(1);
+    /* Wait for the client to report idle before decoding. */
+    m.gate = GATE_CLOSED;
+    if (pthread_create(&decode_tid, NULL, decode_thread, &m) != 0
+        || pthread_create(&capture_tid, NULL, capture_thread, &m) != 0) {
+        E_FATAL("Failed to start threads\n");
+    }
+    affinity_setup("control", cmd_ln_int32_r(config, "-controlcpu"), 0);
+    E_INFO("Ready....\n");
+
+    /*
+     * A client that is already running reports its state in reply.  A
+     * hello carries the seq of the last keyword sent, 0 at startup, and
+     * the client acknowledges it like that keyword.
+     */
+    ctl_header_init(&hello, CTL_HELLO, 0);
+    ctl_send(m.ctl_fd, CTL_CLIENT_PATH, &hello, sizeof(hello));
+
+    pfd.fd = m.ctl_fd;
+    pfd.events = POLLIN;
+    for (;;) {
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            E_FATAL_SYSTEM("Failed to wait for the client");
+        }
+        while ((type = ctl_recv(m.ctl_fd, &msg)) >= 0) {
+            if (type != CTL_STATE)
+                continue;
+            latency_record(&latency[LAT_STATE_DELIVERY], latency_now_ns() - msg.hdr.sent_ns);
+            /*
+             * With barge-in, a keyword may interrupt speech too, but not a
+             * request: while thinking the client's recognizer is busy and
+             * would refuse the tap.
+             */
+            if (msg.state.state != CTL_STATE_IDLE
+                && !(barge_in && msg.state.state == CTL_STATE_SPEAKING)) {
+                __atomic_store_n(&m.gate, GATE_CLOSED, __ATOMIC_RELEASE);
+                continue;
             }
-            
-            if (msgrcv(rcv_sqid, &rcv_buf, sizeof(rcv_buf), 0, 0) == -1) {
-                perror("msgrcv");
-                exit(1);
+            /*
+             * A report that does not acknowledge our last keyword was
+             * sent before the client acted on it, or by a restarted client.
+             * The client handles messages in order, so it answers this hello
+             * after acting on the keyword, with its state at that point.
+             */
+            kw_seq = __atomic_load_n(&m.kw_seq, __ATOMIC_ACQUIRE);
+            if (msg.state.ack_seq != kw_seq) {
+                ctl_header_init(&hello, CTL_HELLO, kw_seq);
+                ctl_send(m.ctl_fd, CTL_CLIENT_PATH, &hello, sizeof(hello));
+                continue;
             }
+            if (__atomic_load_n(&m.gate, __ATOMIC_ACQUIRE) == GATE_CLOSED)
+                __atomic_store_n(&m.gate, GATE_OPENING, __ATOMIC_RELEASE);
+        }
+    }
+}
 
-            if ((ad = ad_open_dev(cmd_ln_str_r(config, "-adcdev"), (int) cmd_ln_float32_r(config, "-samprate"))) == NULL) {
-                E_FATAL("Failed to open audio device\n");
-            }
+static int
+check_wav_header(char *header, int expected_sr)
+{
+    int sr;
 
-            if (ad_start_rec(ad) < 0) {
-                E_FATAL("Failed to start recording\n");
-            }
+    if (header[34] != 0x10) {
+        E_ERROR("Input audio file has [%d] bits per sample instead of 16\n", header[34]);
+        return 0;
+    }
+    if (header[20] != 0x1) {
+        E_ERROR("Input audio file has compression [%d] and not required PCM\n", header[20]);
+        return 0;
+    }
+    if (header[22] != 0x1) {
+        E_ERROR("Input audio file has [%d] channels, expected single channel mono\n", header[22]);
+        return 0;
+    }
+    sr = ((header[24] & 0xFF) | ((header[25] & 0xFF) << 8) | ((header[26] & 0xFF) << 16) | ((header[27] & 0xFF) << 24));
+    if (sr != expected_sr) {
+        E_ERROR("Input audio file has sample rate [%d], but decoder expects [%d]\n", sr, expected_sr);
+        return 0;
+    }
+    return 1;
+}
 
-            printf("%s\n", rcv_buf.mtext);
+/*
+ * Open a 16-bit mono WAV file, or headerless raw audio for any other
+ * extension, positioned at the first sample.
+ */
+static FILE *
+open_audio(char const *fname)
+{
+    FILE *fp;
+    size_t len = strlen(fname);
+
+    if (len > 4 && strcmp(fname + len - 4, ".mp3") == 0) {
+        E_ERROR("Can not decode mp3 files, convert '%s' to WAV 16kHz 16-bit mono.\n", fname);
+        return NULL;
+    }
+    if ((fp = fopen(fname, "rb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open file '%s' for reading", fname);
+        return NULL;
+    }
+    if (len > 4 && strcmp(fname + len - 4, ".wav") == 0) {
+        char waveheader[44];
+        if (fread(waveheader, 1, 44, fp) != 44
+            || !check_wav_header(waveheader, (int)cmd_ln_float32_r(config, "-samprate"))) {
+            E_ERROR("Failed to process file '%s' due to format mismatch.\n", fname);
+            fclose(fp);
+            return NULL;
         }
+    }
+    return fp;
+}
 
-        if (in_speech && !utt_started) {
-            utt_started = TRUE;
-            E_INFO("Listening...\n");
+/* Called for each keyword found by decode_file(); audio_ns is the detection point. */
+typedef void (*detect_cb_t)(void *arg, detect_t *d, char const *hyp, int64 audio_ns);
+
+/*
+ * Stream a file through detect_frame() in FRAME_SAMPLES frames, as fast as
+ * the decoder allows.  Times are nanoseconds of audio from the start of the
+ * file.  If frame_hist is given, the wall time each frame took to decode is
+ * recorded in it.  Returns the number of samples decoded, or -1.
+ */
+static int64
+decode_file(detect_t *d, char const *fname, detect_cb_t cb, void *arg,
+            latency_hist_t *frame_hist)
+{
+    int16 adbuf[FRAME_SAMPLES];
+    FILE *fp;
+    int32 k;
+    int64 samples = 0, audio_ns = 0, t0;
+    int32 samprate = (int32)cmd_ln_float32_r(config, "-samprate");
+    char const *hyp;
+
+    if ((fp = open_audio(fname)) == NULL)
+        return -1;
+
+    detect_restart(d);
+    while ((k = fread(adbuf, sizeof(int16), FRAME_SAMPLES, fp)) > 0) {
+        samples += k;
+        audio_ns = samples * 1000000000 / samprate;
+        t0 = latency_now_ns();
+        hyp = detect_frame(d, adbuf, k, audio_ns);
+        if (frame_hist)
+            latency_record(frame_hist, latency_now_ns() - t0);
+        if (hyp != NULL)
+            cb(arg, d, hyp, audio_ns);
+    }
+    if ((hyp = detect_finish(d, audio_ns)) != NULL)
+        cb(arg, d, hyp, audio_ns);
+    /* Leave an utterance open for the next file or the caller. */
+    if (ps_start_utt(ps) < 0)
+        E_FATAL("Failed to start utterance\n");
+
+    fclose(fp);
+    return samples;
+}
+
+static void
+print_detection(void *arg, detect_t *d, char const *hyp, int64 audio_ns)
+{
+    (void)arg;
+    printf("%s %.3f %.3f\n", hyp, d->kwend_ns / 1e9, audio_ns / 1e9);
+}
+
+/*
+ * Spot the keyword in -infile.  Prints "keyword end detected" in seconds
+ * for every detection.
+ */
+static int
+recognize_from_file()
+{
+    detect_t det;
+
+    detect_init(&det, load_keywords(), TRUE);
+    return decode_file(&det, cmd_ln_str_r(config, "-infile"),
+                       print_detection, NULL, NULL) < 0 ? 1 : 0;
+}
+
+/* Keywords tracked by one benchmark run. */
+#define MAX_BENCH_KEYWORDS 32
+
+typedef struct bench_kw_s {
+    char name[MAX_HYP];
+    uint32 labelled;       /* Files labelled with this keyword. */
+    uint32 accepted;       /* ... in which it was detected. */
+    uint32 false_accepts;  /* Detections not matching a label. */
+    latency_hist_t latency; /* Labelled end of keyword -> detection. */
+} bench_kw_t;
+
+typedef struct bench_s {
+    bench_kw_t kw[MAX_BENCH_KEYWORDS];
+    int n_kw;
+    bench_kw_t *label;     /* Keyword of the current file, NULL if negative. */
+    int64 label_end_ns;    /* Its labelled end, -1 if not given. */
+    uint8 hit;             /* The label has been detected already. */
+} bench_t;
+
+static bench_kw_t *
+bench_keyword(bench_t *b, char const *name)
+{
+    bench_kw_t *kw;
+    int i;
+
+    for (i = 0; i < b->n_kw; ++i) {
+        if (!strcmp(b->kw[i].name, name))
+            return &b->kw[i];
+    }
+    if (b->n_kw == MAX_BENCH_KEYWORDS)
+        E_FATAL("More than %d keywords in benchmark\n", MAX_BENCH_KEYWORDS);
+    kw = &b->kw[b->n_kw++];
+    strncpy(kw->name, name, sizeof(kw->name) - 1);
+    kw->latency.name = kw->name;
+    return kw;
+}
+
+static void
+bench_detection(void *arg, detect_t *d, char const *hyp, int64 audio_ns)
+{
+    bench_t *b = arg;
+    bench_kw_t *kw = bench_keyword(b, hyp);
+
+    if (kw != b->label || b->hit) {
+        ++kw->false_accepts;
+        return;
+    }
+    b->hit = TRUE;
+    ++kw->accepted;
+    /* Without a labelled end, fall back to the decoder's own alignment. */
+    latency_record(&kw->latency,
+                   audio_ns - (b->label_end_ns >= 0 ? b->label_end_ns : d->kwend_ns));
+}
+
+static double
+cpu_seconds(struct rusage const *ru)
+{
+    return ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6
+        + ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6;
+}
+
+/*
+ * Offline benchmark.  -benchdir holds audio files and a labels.txt with
+ * one line per file:
+ *
+ *     <file> <end of keyword in seconds, or -> [<keyword>]
+ *
+ * A file without a keyword is a negative sample.  Every file is streamed
+ * through detect_frame() without pacing, and the report gives real-time
+ * factor, CPU per audio second, peak RSS, per-frame decode time, the
+ * share of frames the pre-gate skipped (with -pregate), and per
+ * keyword the detection latency (in audio time), false rejects and false
+ * accepts per hour of audio.
+ */
+static int
+benchmark()
+{
+    char const *dir = cmd_ln_str_r(config, "-benchdir");
+    char path[1024], line[1024], fname[512];
+    char *end_str, *keyword, *p;
+    static bench_t b;
+    latency_hist_t frame_hist = {"frame_decode"};
+    detect_t det;
+    FILE *labels;
+    struct rusage ru0, ru1;
+    int64 wall0, wall_ns, samples, total_samples = 0;
+    int32 samprate = (int32)cmd_ln_float32_r(config, "-samprate");
+    uint32 n_files = 0, n_failed = 0;
+    double audio_s, cpu_s, hours;
+    int i;
+
+    snprintf(path, sizeof(path), "%s/labels.txt", dir);
+    if ((labels = fopen(path, "r")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open %s", path);
+        return 1;
+    }
+
+    detect_init(&det, load_keywords(), FALSE);
+    for (i = 0; i < det.kws->n_kw; ++i)
+        bench_keyword(&b, det.kws->kw[i].phrase);
+
+    getrusage(RUSAGE_SELF, &ru0);
+    wall0 = latency_now_ns();
+
+    while (fgets(line, sizeof(line), labels) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((p = strtok(line, " \t")) == NULL || p[0] == '#')
+            continue;
+        strncpy(fname, p, sizeof(fname) - 1);
+        fname[sizeof(fname) - 1] = '\0';
+        end_str = strtok(NULL, " \t");
+        keyword = strtok(NULL, "");
+        if (keyword) {
+            keyword += strspn(keyword, " \t");
+            if (*keyword == '\0')
+                keyword = NULL;
         }
 
-        if (!in_speech && utt_started) {
-            /* speech -> silence transition, time to start new utterance  */
-            ps_end_utt(ps);
-            hyp = ps_get_hyp(ps, NULL);
-
-            if (hyp != NULL) {
-                // 2018/05/04 Bling Added
-                if (!strncmp(hyp, pBuffer, m_strlen) && strlen(hyp) == m_strlen) {
-                    strncpy(snd_buf.mtext, hyp, m_strlen);
-
-                    ad_close(ad);
-
-                    if (msgsnd(snd_sqid, &snd_buf, sizeof(snd_buf), 0) == -1) {
-                        perror("msgsnd");
-                        exit(1);
-                    }
-                    
-                    printf("%s\n", snd_buf.mtext);
-                    strcpy(rcv_buf.mtext, "");
-                }
-                // 2018/05/04 Bling Added
-                
-                printf("%s\n", hyp);
-                fflush(stdout);
-            }
+        b.label = keyword ? bench_keyword(&b, keyword) : NULL;
+        b.label_end_ns = end_str && strcmp(end_str, "-") ? (int64)(atof(end_str) * 1e9) : -1;
+        b.hit = FALSE;
 
-            if (ps_start_utt(ps) < 0)
-                E_FATAL("Failed to start utterance\n");
-            utt_started = FALSE;
-            E_INFO("Ready....\n");
+        snprintf(path, sizeof(path), "%s/%s", dir, fname);
+        if ((samples = decode_file(&det, path, bench_detection, &b, &frame_hist)) < 0) {
+            ++n_failed;
+            continue;
         }
-        sleep_msec(100);
+        ++n_files;
+        total_samples += samples;
+        if (b.label)
+            ++b.label->labelled;
+    }
+    fclose(labels);
+
+    wall_ns = latency_now_ns() - wall0;
+    getrusage(RUSAGE_SELF, &ru1);
+
+    audio_s = (double)total_samples / samprate;
+    cpu_s = cpu_seconds(&ru1) - cpu_seconds(&ru0);
+    hours = audio_s / 3600;
+
+    printf("files:           %u (%u failed)\n", n_files, n_failed);
+    printf("audio:           %.1f s\n", audio_s);
+    printf("real-time factor: %.4f\n", audio_s > 0 ? wall_ns / 1e9 / audio_s : 0);
+    printf("cpu per audio s: %.2f ms\n", audio_s > 0 ? cpu_s * 1e3 / audio_s : 0);
+    /* ru_maxrss is in kilobytes on Linux. */
+    printf("peak rss:        %ld kB\n", ru1.ru_maxrss);
+    if (det.gate)
+        printf("pre-gate skipped: %.1f%% of frames\n",
+               pregate_frames(det.gate)
+               ? 100.0 * pregate_skipped(det.gate) / pregate_frames(det.gate) : 0);
+    latency_dump(stdout, &frame_hist, 1);
+    printf("\n%-24s %8s %8s %8s %10s\n", "keyword", "labelled", "FR", "FA", "FA/hour");
+    for (i = 0; i < b.n_kw; ++i) {
+        bench_kw_t *kw = &b.kw[i];
+        printf("%-24s %8u %7.2f%% %8u %10.2f\n", kw->name, kw->labelled,
+               kw->labelled ? 100.0 * (kw->labelled - kw->accepted) / kw->labelled : 0,
+               kw->false_accepts, hours > 0 ? kw->false_accepts / hours : 0);
+    }
+    printf("\ndetection latency (end of keyword -> detection, audio time):\n");
+    for (i = 0; i < b.n_kw; ++i)
+        latency_dump(stdout, &b.kw[i].latency, 1);
+    fflush(stdout);
+
+    return n_failed ? 1 : 0;
+}
+
+/*
+ * Offline echo canceller benchmark.  -aecbench holds recordings of the
+ * microphone and of the echo reference, captured at the same time, and a
+ * pairs.txt with one line per pair:
+ *
+ *     <microphone file> <reference file>
+ *
+ * Each pair is cancelled frame by frame from a fresh filter, as the
+ * capture thread would, but without real-time pacing.  The report gives
+ * per pair the ERLE (how much the echo was attenuated, over the frames
+ * with reference), and overall the real-time factor, CPU per audio second
+ * and the per-frame processing time, which must stay well under the 20 ms
+ * of a frame on one core.
+ */
+static int
+aec_benchmark()
+{
+    char const *dir = cmd_ln_str_r(config, "-aecbench");
+    char path[1024], line[1024];
+    char *mic_name, *ref_name;
+    int16 mic[FRAME_SAMPLES], ref[FRAME_SAMPLES];
+    latency_hist_t frame_hist = {"aec_frame"};
+    FILE *pairs, *mic_fp, *ref_fp;
+    struct rusage ru0, ru1;
+    aec_t *aec;
+    int64 wall0, wall_ns, t0, samples, total_samples = 0;
+    int32 samprate = (int32)cmd_ln_float32_r(config, "-samprate");
+    int32 k;
+    uint32 n_files = 0, n_failed = 0;
+    double audio_s, cpu_s, erle, erle_sum = 0;
+
+    snprintf(path, sizeof(path), "%s/pairs.txt", dir);
+    if ((pairs = fopen(path, "r")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open %s", path);
+        return 1;
+    }
+
+    aec = aec_from_config(samprate);
+    getrusage(RUSAGE_SELF, &ru0);
+    wall0 = latency_now_ns();
+
+    printf("%-32s %10s\n", "microphone", "ERLE");
+    while (fgets(line, sizeof(line), pairs) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((mic_name = strtok(line, " \t")) == NULL || mic_name[0] == '#')
+            continue;
+        if ((ref_name = strtok(NULL, " \t")) == NULL) {
+            E_ERROR("No reference for %s in pairs.txt\n", mic_name);
+            ++n_failed;
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", dir, mic_name);
+        if ((mic_fp = open_audio(path)) == NULL) {
+            ++n_failed;
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, ref_name);
+        if ((ref_fp = open_audio(path)) == NULL) {
+            fclose(mic_fp);
+            ++n_failed;
+            continue;
+        }
+
+        aec_reset(aec);
+        samples = 0;
+        /* A pair is cancelled as far as the shorter recording goes. */
+        while ((k = fread(mic, sizeof(int16), FRAME_SAMPLES, mic_fp)) > 0
+               && (k = fread(ref, sizeof(int16), k, ref_fp)) > 0) {
+            t0 = latency_now_ns();
+            aec_process(aec, mic, ref, k);
+            latency_record(&frame_hist, latency_now_ns() - t0);
+            samples += k;
+        }
+        fclose(mic_fp);
+        fclose(ref_fp);
+
+        erle = aec_erle_db(aec);
+        printf("%-32s %7.1f dB\n", mic_name, erle);
+        erle_sum += erle;
+        total_samples += samples;
+        ++n_files;
+    }
+    fclose(pairs);
+
+    wall_ns = latency_now_ns() - wall0;
+    getrusage(RUSAGE_SELF, &ru1);
+    aec_free(aec);
+
+    audio_s = (double)total_samples / samprate;
+    cpu_s = cpu_seconds(&ru1) - cpu_seconds(&ru0);
+
+    printf("\nfiles:           %u (%u failed)\n", n_files, n_failed);
+    printf("audio:           %.1f s\n", audio_s);
+    printf("mean ERLE:       %.1f dB\n", n_files ? erle_sum / n_files : 0);
+    printf("real-time factor: %.4f\n", audio_s > 0 ? wall_ns / 1e9 / audio_s : 0);
+    printf("cpu per audio s: %.2f ms\n", audio_s > 0 ? cpu_s * 1e3 / audio_s : 0);
+    latency_dump(stdout, &frame_hist, 1);
+    fflush(stdout);
+
+    return n_failed ? 1 : 0;
+}
+
+/*
+ * Low-power preset.  Acoustic scoring dominates the cost of always-on
+ * listening: score every other frame, keep the two best Gaussians per
+ * senone and prune harder.  Keyword spotting barely notices; check the
+ * accuracy cost on your own data with -benchdir.
+ */
+static const struct {
+    char const *name;
+    long value;
+} lowpower_args[] = {
+    {"-ds", 2},
+    {"-topn", 2},
+    {"-maxhmmpf", 3000},
+    {"-maxwpf", 5},
+    {"-pl_window", 5},
+    {"-fwdflat", FALSE},
+    {"-bestpath", FALSE},
+};
+
+/* The default of an integer or boolean option, as the decoder parses it. */
+static long
+arg_default(char const *name)
+{
+    arg_t const *arg;
+
+    for (arg = cont_args_def; arg->name; ++arg) {
+        if (strcmp(arg->name, name) != 0 || arg->deflt == NULL)
+            continue;
+        if (arg->type & ARG_BOOLEAN)
+            return strchr("yYtT1", arg->deflt[0]) != NULL;
+        return atol(arg->deflt);
+    }
+    return 0;
+}
+
+/* Options given on the command line or in -argfile are kept. */
+static void
+apply_lowpower(cmd_ln_t *config)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(lowpower_args) / sizeof(lowpower_args[0]); ++i) {
+        char const *name = lowpower_args[i].name;
+        long value = cmd_ln_int_r(config, name);
+
+        if (value != arg_default(name)) {
+            if (value != lowpower_args[i].value)
+                E_WARN("Low-power decoding keeps %s %ld, set explicitly, instead of %ld\n",
+                       name, value, lowpower_args[i].value);
+            continue;
+        }
+        cmd_ln_set_int_r(config, name, lowpower_args[i].value);
+        E_INFO("Low-power decoding: %s %ld\n", name, lowpower_args[i].value);
     }
-    ad_close(ad);
 }
 
 int
 main(int argc, char** argv)
 {
     char const *cfg;
+    int ret = 0;
+    int64 init_ns;
 
     config = cmd_ln_parse_r(NULL, cont_args_def, argc, argv, TRUE);
 
@@ -276,23 +1717,43 @@ main(int argc, char** argv)
         config = cmd_ln_parse_file_r(config, cont_args_def, cfg, FALSE);
     }
 
-    if (config == NULL || (cmd_ln_str_r(config, "-infile") == NULL && cmd_ln_boolean_r(config, "-inmic") == FALSE)) {
-	E_INFO("Specify '-infile <file.wav>' to recognize from file or '-inmic yes' to recognize from microphone.\n");
+    if (config == NULL || (cmd_ln_str_r(config, "-infile") == NULL && cmd_ln_str_r(config, "-benchdir") == NULL
+                           && cmd_ln_str_r(config, "-aecbench") == NULL
+                           && cmd_ln_boolean_r(config, "-inmic") == FALSE)) {
+	E_INFO("Specify '-infile <file.wav>' to recognize from file, '-benchdir <dir>' to benchmark, '-aecbench <dir>' to benchmark echo cancellation or '-inmic yes' to recognize from microphone.\n");
         cmd_ln_free_r(config);
 	return 1;
     }
 
+    /* The echo canceller needs no models. */
+    if (cmd_ln_str_r(config, "-aecbench") != NULL) {
+        ret = aec_benchmark();
+        cmd_ln_free_r(config);
+        return ret;
+    }
+
+    init_ns = latency_now_ns();
     ps_default_search_args(config);
+    if (cmd_ln_boolean_r(config, "-lowpower"))
+        apply_lowpower(config);
+    /* A failed conversion leaves the text model, which still works. */
+    if (cmd_ln_str_r(config, "-lmcache") != NULL)
+        model_lm_cache(config, cmd_ln_str_r(config, "-lmcache"));
+    if (cmd_ln_boolean_r(config, "-readahead"))
+        model_readahead(config);
     ps = ps_init(config);
     if (ps == NULL) {
         cmd_ln_free_r(config);
         return 1;
     }
+    E_INFO("Decoder initialized in %.0f ms\n", (latency_now_ns() - init_ns) / 1e6);
 
     E_INFO("%s COMPILED ON: %s, AT: %s\n\n", argv[0], __DATE__, __TIME__);
 
-    if (cmd_ln_str_r(config, "-infile") != NULL) {
-        //recognize_from_file();
+    if (cmd_ln_str_r(config, "-benchdir") != NULL) {
+        ret = benchmark();
+    } else if (cmd_ln_str_r(config, "-infile") != NULL) {
+        ret = recognize_from_file();
     } else if (cmd_ln_boolean_r(config, "-inmic")) {
         recognize_from_microphone();
     }
@@ -300,7 +1761,7 @@ main(int argc, char** argv)
     ps_free(ps);
     cmd_ln_free_r(config);
 
-    return 0;
+    return ret;
 }
 
 #if defined(_WIN32_WCE)
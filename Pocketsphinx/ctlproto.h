@@ -0,0 +1,183 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * ctlproto.h - Control protocol between the recognizer and the Alexa client
+ *
+ * Each side binds a Unix datagram socket at a fixed path and sends
+ * fixed-layout binary messages to the other's path, without blocking: a
+ * message to a peer that is not running is dropped, and the peer catches
+ * up from the next one.  The client reports its dialog state, the
+ * recognizer reports keywords.  Every message starts with a header
+ * carrying the protocol version, a per-sender sequence number and the
+ * CLOCK_MONOTONIC send time, so the receiver can measure delivery latency.
+ *
+ * Messages of another version are rejected; fields may only be appended
+ * within a version, so a receiver accepts messages at least as long as the
+ * layout it knows.  Only <stdint.h> types are used so that the client can
+ * include this header without sphinxbase.
+ */
+
+#ifndef __CTLPROTO_H__
+#define __CTLPROTO_H__
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CTL_MAGIC   0x4354 /* "CT" */
+#define CTL_VERSION 2 /* 2: CTL_KEYWORD carries the direction of arrival. */
+
+#define CTL_RECOGNIZER_PATH "/tmp/a113d-recognizer.sock"
+#define CTL_CLIENT_PATH     "/tmp/a113d-client.sock"
+
+/* Longest keyword phrase, including the NUL; KEYWORD_MAX_LEN in keywords.h. */
+#define CTL_PHRASE_MAX 128
+
+typedef enum ctl_type_e {
+    CTL_HELLO = 1,          /* recognizer -> client: (re)started, report your state; see ctl_header_t.seq */
+    CTL_STATE = 2,          /* client -> recognizer: dialog state */
+    CTL_KEYWORD = 3         /* recognizer -> client: keyword detected */
+} ctl_type_t;
+
+typedef enum ctl_state_e {
+    CTL_STATE_DISCONNECTED = 0,
+    CTL_STATE_CONNECTING = 1,
+    CTL_STATE_IDLE = 2,
+    CTL_STATE_LISTENING = 3,
+    CTL_STATE_THINKING = 4,
+    CTL_STATE_SPEAKING = 5
+} ctl_state_t;
+
+typedef struct ctl_header_s {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;           /* ctl_type_t */
+    /*
+     * CTL_KEYWORD and CTL_STATE: per sender, from 1.  CTL_HELLO has no
+     * sequence of its own and carries the seq of the last CTL_KEYWORD
+     * sent, 0 if none; the client acknowledges it like that keyword.
+     */
+    uint32_t seq;
+    int64_t sent_ns;        /* CLOCK_MONOTONIC */
+} ctl_header_t;
+
+typedef struct ctl_state_msg_s {
+    ctl_header_t hdr;
+    uint32_t ack_seq;       /* Last keyword the client has acted on, 0 if none. */
+    uint8_t state;          /* ctl_state_t */
+    uint8_t reserved[3];
+} ctl_state_msg_t;
+
+typedef struct ctl_keyword_msg_s {
+    ctl_header_t hdr;
+    int64_t kwend_ns;       /* CLOCK_MONOTONIC time at which the keyword ended. */
+    int64_t detect_ns;      /* ... and at which it was detected. */
+    int32_t keyword_id;     /* Index in the recognizer's keyword table, -1 if not in it. */
+    int16_t doa_deg;        /* Azimuth of the talker in degrees (0-359), -1 without a microphone array. */
+    uint16_t reserved;
+    char phrase[CTL_PHRASE_MAX];
+} ctl_keyword_msg_t;
+
+typedef union ctl_msg_u {
+    ctl_header_t hdr;
+    ctl_state_msg_t state;
+    ctl_keyword_msg_t keyword;
+} ctl_msg_t;
+
+static inline int64_t
+ctl_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Bind a non-blocking datagram socket at path, replacing a stale one.  Returns the fd or -1. */
+static inline int
+ctl_open(char const *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if ((fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static inline void
+ctl_header_init(ctl_header_t *hdr, ctl_type_t type, uint32_t seq)
+{
+    hdr->magic = CTL_MAGIC;
+    hdr->version = CTL_VERSION;
+    hdr->type = (uint8_t)type;
+    hdr->seq = seq;
+    hdr->sent_ns = ctl_now_ns();
+}
+
+/* Send without blocking.  Returns 0, or -1 with errno set (ENOENT or ECONNREFUSED: no peer). */
+static inline int
+ctl_send(int fd, char const *peer, void const *msg, size_t len)
+{
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, peer, sizeof(addr.sun_path) - 1);
+    return sendto(fd, msg, len, MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr)) < 0 ? -1 : 0;
+}
+
+/*
+ * Receive one message without blocking.  Returns its type, 0 for a
+ * message that is malformed or of another version (skip it), or -1 with
+ * errno set, EAGAIN when there is none.
+ */
+static inline int
+ctl_recv(int fd, ctl_msg_t *msg)
+{
+    ssize_t len = recv(fd, msg, sizeof(*msg), MSG_DONTWAIT);
+    size_t need;
+
+    if (len < 0)
+        return -1;
+    if ((size_t)len < sizeof(ctl_header_t) || msg->hdr.magic != CTL_MAGIC
+        || msg->hdr.version != CTL_VERSION)
+        return 0;
+    switch (msg->hdr.type) {
+    case CTL_HELLO:
+        need = sizeof(ctl_header_t);
+        break;
+    case CTL_STATE:
+        need = sizeof(ctl_state_msg_t);
+        break;
+    case CTL_KEYWORD:
+        need = sizeof(ctl_keyword_msg_t);
+        msg->keyword.phrase[CTL_PHRASE_MAX - 1] = '\0';
+        break;
+    default:
+        return 0;
+    }
+    return (size_t)len < need ? 0 : msg->hdr.type;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CTLPROTO_H__ */
@@ -0,0 +1,269 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * keywords.c - Keyword table for continuous.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "keywords.h"
+
+/* Collapse runs of white space to single spaces and trim both ends, in place. */
+static void
+normalize_phrase(char *s)
+{
+    char *in, *out = s;
+
+    for (in = s; *in; ++in) {
+        if (isspace((unsigned char)*in)) {
+            if (out > s && out[-1] != ' ')
+                *out++ = ' ';
+        }
+        else
+            *out++ = *in;
+    }
+    if (out > s && out[-1] == ' ')
+        --out;
+    *out = '\0';
+}
+
+static int
+keywords_add(keywords_t *kws, char const *phrase, float64 threshold)
+{
+    keyword_t *kw;
+
+    if (strlen(phrase) >= KEYWORD_MAX_LEN) {
+        E_ERROR("Keyword '%s' is longer than %d characters\n", phrase, KEYWORD_MAX_LEN - 1);
+        return -1;
+    }
+    if (keywords_find(kws, phrase) != NULL) {
+        E_WARN("Duplicate keyword '%s' ignored, the first one is kept\n", phrase);
+        return 0;
+    }
+
+    kws->kw = ckd_realloc(kws->kw, (kws->n_kw + 1) * sizeof(*kws->kw));
+    kw = &kws->kw[kws->n_kw];
+    kw->phrase = ckd_salloc(phrase);
+    kw->threshold = threshold;
+    kw->longer_words = 0;
+    /* The hash table keeps the key pointer, which stays valid across realloc. */
+    hash_table_enter_int32(kws->ht, kw->phrase, kws->n_kw);
+    ++kws->n_kw;
+    return 0;
+}
+
+static int32
+count_words(char const *phrase)
+{
+    int32 n = 1;
+
+    while ((phrase = strchr(phrase, ' ')) != NULL) {
+        ++phrase;
+        ++n;
+    }
+    return n;
+}
+
+/*
+ * The keyphrase search reports "alexa" as soon as it is heard, before
+ * "alexa stop" can finish, so note for every phrase how many words the
+ * longest keyword starting with it adds.
+ */
+static void
+keywords_find_prefixes(keywords_t *kws, char const *path)
+{
+    keyword_t *kw, *longer;
+    size_t len;
+    int32 i, j, extra;
+
+    for (i = 0; i < kws->n_kw; ++i) {
+        kw = &kws->kw[i];
+        len = strlen(kw->phrase);
+        for (j = 0; j < kws->n_kw; ++j) {
+            longer = &kws->kw[j];
+            if (strncmp(longer->phrase, kw->phrase, len) != 0 || longer->phrase[len] != ' ')
+                continue;
+            extra = count_words(longer->phrase) - count_words(kw->phrase);
+            if (kw->longer_words == 0)
+                E_WARN("%s: '%s' is the start of '%s' and is reported only once that could have been said\n",
+                       path, kw->phrase, longer->phrase);
+            if (extra > kw->longer_words)
+                kw->longer_words = extra;
+        }
+    }
+}
+
+static keywords_t *
+keywords_new(void)
+{
+    keywords_t *kws = ckd_calloc(1, sizeof(*kws));
+
+    kws->ht = hash_table_new(16, HASH_CASE_YES);
+    return kws;
+}
+
+/* Whether s is all white space. */
+static int
+is_blank(char const *s)
+{
+    return s[strspn(s, " \t\r\n")] == '\0';
+}
+
+/*
+ * Check the action columns, which only the client acts on, so that both
+ * programs accept the same lines: nothing, "tap", "stop" or "volume" and
+ * an integer.
+ */
+static int
+check_action(char *columns)
+{
+    char *action, *arg, *end, *save;
+
+    if ((action = strtok_r(columns, " \t\r\n", &save)) == NULL)
+        return 0;
+    if (strcmp(action, "volume") == 0) {
+        if ((arg = strtok_r(NULL, " \t\r\n", &save)) == NULL)
+            return -1;
+        strtol(arg, &end, 10);
+        if (end == arg || *end != '\0')
+            return -1;
+    }
+    else if (strcmp(action, "tap") != 0 && strcmp(action, "stop") != 0)
+        return -1;
+    return strtok_r(NULL, " \t\r\n", &save) == NULL ? 0 : -1;
+}
+
+/*
+ * Split a line into its phrase and threshold.  Returns 1 for a keyword, 0
+ * for a blank or comment line and -1 for a malformed one.
+ */
+static int
+parse_line(char *line, char **phrase, float64 *threshold)
+{
+    char *open, *close, *end;
+
+    *phrase = line + strspn(line, " \t\r\n");
+    if (**phrase == '\0' || **phrase == '#')
+        return 0;
+
+    if ((open = strchr(*phrase, '/')) != NULL) {
+        if ((close = strchr(open + 1, '/')) == NULL)
+            return -1;
+        *open = *close = '\0';
+        *threshold = strtod(open + 1, &end);
+        if (end == open + 1 || !is_blank(end) || check_action(close + 1) < 0)
+            return -1;
+    }
+    normalize_phrase(*phrase);
+    return **phrase == '\0' ? -1 : 1;
+}
+
+keywords_t *
+keywords_load(char const *path, float64 default_threshold)
+{
+    keywords_t *kws;
+    FILE *fp;
+    char line[1024];
+    char *phrase;
+    float64 threshold;
+    int lineno = 0, c;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return NULL;
+
+    kws = keywords_new();
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        ++lineno;
+        if (strchr(line, '\n') == NULL && !feof(fp)) {
+            E_WARN("%s:%d: line too long, skipped\n", path, lineno);
+            while ((c = fgetc(fp)) != EOF && c != '\n')
+                ;
+            continue;
+        }
+        threshold = default_threshold;
+        switch (parse_line(line, &phrase, &threshold)) {
+        case 0:
+            break;
+        case 1:
+            if (keywords_add(kws, phrase, threshold) == 0)
+                break;
+            /* fall through */
+        default:
+            E_WARN("%s:%d: malformed line skipped\n", path, lineno);
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (kws->n_kw == 0) {
+        E_ERROR("No keywords in %s\n", path);
+        keywords_free(kws);
+        return NULL;
+    }
+    keywords_find_prefixes(kws, path);
+    return kws;
+}
+
+keywords_t *
+keywords_single(char const *phrase, float64 threshold)
+{
+    keywords_t *kws = keywords_new();
+    char *copy = ckd_salloc(phrase);
+
+    normalize_phrase(copy);
+    if (*copy == '\0' || keywords_add(kws, copy, threshold) < 0) {
+        ckd_free(copy);
+        keywords_free(kws);
+        return NULL;
+    }
+    ckd_free(copy);
+    return kws;
+}
+
+keyword_t const *
+keywords_find(keywords_t *kws, char const *hyp)
+{
+    int32 idx;
+
+    if (hash_table_lookup_int32(kws->ht, hyp, &idx) < 0)
+        return NULL;
+    return &kws->kw[idx];
+}
+
+int
+keywords_write_kws(keywords_t *kws, char const *path, float64 scale)
+{
+    FILE *fp;
+    int32 i;
+
+    if ((fp = fopen(path, "w")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open %s", path);
+        return -1;
+    }
+    for (i = 0; i < kws->n_kw; ++i)
+        fprintf(fp, "%s /%g/\n", kws->kw[i].phrase, kws->kw[i].threshold * scale);
+    if (fclose(fp) != 0) {
+        E_ERROR_SYSTEM("Failed to write %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+void
+keywords_free(keywords_t *kws)
+{
+    int32 i;
+
+    if (kws == NULL)
+        return;
+    for (i = 0; i < kws->n_kw; ++i)
+        ckd_free(kws->kw[i].phrase);
+    ckd_free(kws->kw);
+    hash_table_free(kws->ht);
+    ckd_free(kws);
+}
@@ -0,0 +1,72 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * keywords.h - Keyword table for continuous.c
+ *
+ * The table is a text file with one keyword per line:
+ *
+ *     <phrase> [/<threshold>/ [<action> [<argument>]]]
+ *
+ * e.g. "alexa /1e-20/ tap".  A line without slashes is all phrase.  The recognizer only needs phrases and
+ * thresholds; the action columns are read by the Alexa client from the
+ * same file.  Lines starting with '#' are comments.  Phrases are kept in a
+ * hash table, so matching a hypothesis is a single lookup.
+ */
+
+#ifndef __KEYWORDS_H__
+#define __KEYWORDS_H__
+
+#include <sphinxbase/prim_type.h>
+#include <sphinxbase/hash_table.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Longest phrase, including the terminating NUL, that fits in a message to
+ * the client.  Longer phrases are rejected when the table is loaded rather
+ * than truncated on the wire.
+ */
+#define KEYWORD_MAX_LEN 128
+
+typedef struct keyword_s {
+    char *phrase;       /* Words separated by single spaces. */
+    float64 threshold;  /* Keyphrase search threshold. */
+    int32 longer_words; /* Words the longest keyword that starts with this
+                           phrase adds to it, 0 if there is none. */
+} keyword_t;
+
+typedef struct keywords_s {
+    keyword_t *kw;
+    int32 n_kw;
+    hash_table_t *ht;   /* phrase -> index into kw */
+} keywords_t;
+
+/**
+ * Load a keyword table.  Keywords without a threshold get
+ * default_threshold.  A phrase that is the start of a longer one ("alexa"
+ * and "alexa stop") is logged, as the recognizer has to hold it back until
+ * the longer one could have been said.  Returns NULL if the file cannot
+ * be read or has no valid keyword.
+ */
+keywords_t *keywords_load(char const *path, float64 default_threshold);
+
+/** A table holding the single keyword phrase. */
+keywords_t *keywords_single(char const *phrase, float64 threshold);
+
+/** The keyword whose phrase is exactly hyp, or NULL. */
+keyword_t const *keywords_find(keywords_t *kws, char const *hyp);
+
+/**
+ * Write the table in the format ps_set_kws() reads ("phrase /threshold/"),
+ * with every threshold multiplied by scale (1 writes them unchanged).
+ */
+int keywords_write_kws(keywords_t *kws, char const *path, float64 scale);
+
+void keywords_free(keywords_t *kws);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KEYWORDS_H__ */
@@ -0,0 +1,113 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * latency.c - Per-stage latency histograms for continuous.c
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include <sphinxbase/err.h>
+
+#include "latency.h"
+
+int64
+latency_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Bucket 4*msb + the two bits below the most significant bit of the microseconds. */
+static int
+bucket_of(int64 ns)
+{
+    uint64 us = ns > 0 ? (uint64)ns / 1000 : 0;
+    int msb;
+
+    if (us < 4)
+        return (int)us;
+    for (msb = 63; !(us >> msb); --msb)
+        ;
+    return msb * 4 + (int)((us >> (msb - 2)) & 3);
+}
+
+static int64
+bucket_upper_ns(int b)
+{
+    int msb = b / 4;
+
+    if (b < 4)
+        return (int64)(b + 1) * 1000;
+    return (int64)(((uint64)(4 + b % 4 + 1) << (msb - 2)) * 1000);
+}
+
+void
+latency_record(latency_hist_t *h, int64 ns)
+{
+    int b = bucket_of(ns);
+
+    if (b >= LATENCY_BUCKETS)
+        b = LATENCY_BUCKETS - 1;
+    ++h->bucket[b];
+    ++h->count;
+    if (ns > h->max_ns)
+        h->max_ns = ns;
+}
+
+int64
+latency_percentile(latency_hist_t const *h, double p)
+{
+    uint32 rank, seen = 0;
+    int b;
+
+    if (h->count == 0)
+        return 0;
+    rank = (uint32)(p * h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    for (b = 0; b < LATENCY_BUCKETS; ++b) {
+        seen += h->bucket[b];
+        if (seen >= rank) {
+            int64 upper = bucket_upper_ns(b);
+            return upper < h->max_ns ? upper : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+void
+latency_dump(FILE *fp, latency_hist_t const *hists, int n_hists)
+{
+    int i;
+
+    for (i = 0; i < n_hists; ++i) {
+        latency_hist_t const *h = &hists[i];
+        fprintf(fp, "%-24s count=%u p50=%.2fms p95=%.2fms p99=%.2fms max=%.2fms\n",
+                h->name, h->count,
+                latency_percentile(h, 0.50) / 1e6,
+                latency_percentile(h, 0.95) / 1e6,
+                latency_percentile(h, 0.99) / 1e6,
+                h->max_ns / 1e6);
+    }
+}
+
+int
+latency_dump_file(char const *path, latency_hist_t const *hists, int n_hists)
+{
+    char tmp[512];
+    FILE *fp;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if ((fp = fopen(tmp, "w")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open %s", tmp);
+        return -1;
+    }
+    latency_dump(fp, hists, n_hists);
+    if (fclose(fp) != 0 || rename(tmp, path) != 0) {
+        E_ERROR_SYSTEM("Failed to write %s", path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * latency.h - Per-stage latency histograms for continuous.c
+ *
+ * Each stage keeps a fixed log-scale histogram (four buckets per octave of
+ * microseconds), so recording is a couple of integer operations and never
+ * allocates.  Percentiles are reported as bucket upper bounds, i.e. within
+ * about 19% of the true value.
+ */
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <stdio.h>
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_BUCKETS 128
+
+typedef struct latency_hist_s {
+    char const *name;
+    uint32 count;
+    int64 max_ns;
+    uint32 bucket[LATENCY_BUCKETS];
+} latency_hist_t;
+
+/** CLOCK_MONOTONIC time in nanoseconds. */
+int64 latency_now_ns(void);
+
+/** Add one sample of ns nanoseconds to the histogram. */
+void latency_record(latency_hist_t *h, int64 ns);
+
+/** Upper bound of the p-th percentile (0 < p <= 1) in nanoseconds, 0 if empty. */
+int64 latency_percentile(latency_hist_t const *h, double p);
+
+/** Write count, p50, p95, p99 and max of each histogram, one line per stage. */
+void latency_dump(FILE *fp, latency_hist_t const *hists, int n_hists);
+
+/**
+ * Overwrite path with latency_dump() output.  Writes to a temporary file
+ * and renames it so readers never see a partial snapshot.
+ */
+int latency_dump_file(char const *path, latency_hist_t const *hists, int n_hists);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LATENCY_H__ */
@@ -0,0 +1,178 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * modelload.c - Faster model loading at recognizer startup
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/logmath.h>
+#include <sphinxbase/ngram_model.h>
+
+#include "modelload.h"
+
+static void
+readahead_file(char const *path)
+{
+    int fd;
+
+    if (path == NULL || (fd = open(path, O_RDONLY)) < 0)
+        return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+void
+model_readahead(cmd_ln_t *config)
+{
+    char const *hmm = cmd_ln_str_r(config, "-hmm");
+    char path[1024];
+    struct dirent *de;
+    DIR *dir;
+
+    if (hmm && (dir = opendir(hmm)) != NULL) {
+        while ((de = readdir(dir)) != NULL) {
+            if (de->d_name[0] == '.')
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", hmm, de->d_name);
+            readahead_file(path);
+        }
+        closedir(dir);
+    }
+    readahead_file(cmd_ln_str_r(config, "-dict"));
+    readahead_file(cmd_ln_str_r(config, "-fdict"));
+    readahead_file(cmd_ln_str_r(config, "-lm"));
+    readahead_file(cmd_ln_str_r(config, "-jsgf"));
+}
+
+/* Models in either binary format load without parsing. */
+static int
+is_binary_lm(char const *path)
+{
+    size_t len = strlen(path);
+
+    return (len > 4 && strcmp(path + len - 4, ".bin") == 0)
+        || (len > 4 && strcmp(path + len - 4, ".DMP") == 0);
+}
+
+/* FNV-1a, to tell apart models with the same file name. */
+static uint64_t
+hash_path(char const *path)
+{
+    uint64_t h = 14695981039346656037ULL;
+
+    while (*path)
+        h = (h ^ (unsigned char)*path++) * 1099511628211ULL;
+    return h;
+}
+
+/*
+ * The stamp file next to the cache records the size and modification time
+ * of the text model it was converted from.  Returns TRUE if they still match.
+ */
+static int
+stamp_matches(char const *stamp_path, struct stat const *src)
+{
+    long long size, sec, nsec;
+    FILE *fh;
+    int n;
+
+    if ((fh = fopen(stamp_path, "r")) == NULL)
+        return FALSE;
+    n = fscanf(fh, "%lld %lld %lld", &size, &sec, &nsec);
+    fclose(fh);
+    return n == 3 && size == (long long)src->st_size
+        && sec == (long long)src->st_mtim.tv_sec
+        && nsec == (long long)src->st_mtim.tv_nsec;
+}
+
+static int
+stamp_write(char const *stamp_path, struct stat const *src)
+{
+    char tmp_path[PATH_MAX + 8];
+    FILE *fh;
+    int rv;
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", stamp_path) >= (int)sizeof(tmp_path)
+        || (fh = fopen(tmp_path, "w")) == NULL)
+        return -1;
+    rv = fprintf(fh, "%lld %lld %lld\n", (long long)src->st_size,
+                 (long long)src->st_mtim.tv_sec, (long long)src->st_mtim.tv_nsec);
+    if (fclose(fh) != 0 || rv < 0 || rename(tmp_path, stamp_path) < 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int
+model_lm_cache(cmd_ln_t *config, char const *cache_dir)
+{
+    char const *lm_path = cmd_ln_str_r(config, "-lm");
+    char const *base;
+    char full_path[PATH_MAX];
+    char cache_path[PATH_MAX], stamp_path[PATH_MAX + 8], tmp_path[PATH_MAX + 8];
+    struct stat src;
+    logmath_t *lmath;
+    ngram_model_t *lm;
+
+    if (lm_path == NULL || is_binary_lm(lm_path))
+        return 0;
+    if (stat(lm_path, &src) < 0) {
+        E_ERROR_SYSTEM("Failed to stat %s", lm_path);
+        return -1;
+    }
+    if (realpath(lm_path, full_path) == NULL) {
+        E_ERROR_SYSTEM("Failed to resolve %s", lm_path);
+        return -1;
+    }
+    base = strrchr(full_path, '/');
+    base = base ? base + 1 : full_path;
+    /* A truncated name could be another model's cache. */
+    if (snprintf(cache_path, sizeof(cache_path), "%s/%s.%016llx.bin", cache_dir, base,
+                 (unsigned long long)hash_path(full_path)) >= (int)sizeof(cache_path)
+        || snprintf(stamp_path, sizeof(stamp_path), "%s.src", cache_path) >= (int)sizeof(stamp_path)
+        || snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path) >= (int)sizeof(tmp_path)) {
+        E_ERROR("Cache path for %s in %s is too long\n", full_path, cache_dir);
+        return -1;
+    }
+
+    if (access(cache_path, R_OK) < 0 || !stamp_matches(stamp_path, &src)) {
+        E_INFO("Converting %s to %s\n", lm_path, cache_path);
+        /* Same log base as the decoder's, which is what the file stores. */
+        lmath = logmath_init(cmd_ln_float32_r(config, "-logbase"), 0, FALSE);
+        lm = ngram_model_read(config, lm_path, NGRAM_AUTO, lmath);
+        if (lm == NULL) {
+            logmath_free(lmath);
+            return -1;
+        }
+        /*
+         * Write under another name, so a crash never leaves half a cache,
+         * and stamp it last: without a matching stamp it is converted again.
+         * The stamp is the source as stat()ed before reading, so a model
+         * edited during the conversion does not match either.
+         */
+        unlink(stamp_path);
+        if (ngram_model_write(lm, tmp_path, NGRAM_BIN) < 0
+            || rename(tmp_path, cache_path) < 0
+            || stamp_write(stamp_path, &src) < 0) {
+            E_ERROR_SYSTEM("Failed to write %s", cache_path);
+            unlink(tmp_path);
+            ngram_model_free(lm);
+            logmath_free(lmath);
+            return -1;
+        }
+        ngram_model_free(lm);
+        logmath_free(lmath);
+    }
+    cmd_ln_set_str_r(config, "-lm", cache_path);
+    return 0;
+}
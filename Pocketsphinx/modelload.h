@@ -0,0 +1,36 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * modelload.h - Faster model loading at recognizer startup
+ */
+
+#ifndef __MODELLOAD_H__
+#define __MODELLOAD_H__
+
+#include <sphinxbase/cmd_ln.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Ask the kernel to start reading the acoustic model directory (-hmm),
+ * the dictionaries, the language model and the grammar into the page cache,
+ * so that ps_init() finds most of them there instead of waiting on each
+ * read in turn.  Returns at once.
+ */
+void model_readahead(cmd_ln_t *config);
+
+/**
+ * Point -lm at a binary copy of it in cache_dir, converting the text model
+ * first if the copy is missing or was made from a model of another size or
+ * modification time.  The copy is named after the model's full path, so
+ * models with the same file name do not share one.  Binary models load
+ * without parsing.  Returns 0, or -1 with -lm left as it was.
+ */
+int model_lm_cache(cmd_ln_t *config, char const *cache_dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MODELLOAD_H__ */
@@ -0,0 +1,163 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * pregate.c - Energy/zero-crossing gate in front of the decoder
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "pregate.h"
+
+/* Zero-crossing rate above which a quieter frame still counts (fricatives). */
+#define FRICATIVE_ZCR 0.3f
+/* Frames quieter than this are never speech, whatever the floor (dB re 1 LSB^2). */
+#define MIN_SPEECH_DB 20.0f
+/* How fast the noise floor rises towards louder background, per frame. */
+#define FLOOR_RISE 0.005f
+
+struct pregate_s {
+    int32 frame_samples;
+    float32 margin_db;
+    float32 floor_db;
+    uint8 have_floor;
+    int32 hangover;          /* Frames to keep passing after speech. */
+    int32 hang_left;
+    int16 *lookback;         /* n_lookback frames, a ring. */
+    int32 *lookback_n;
+    int64 *lookback_ns;
+    int32 n_lookback;
+    int32 lookback_head;     /* Oldest frame. */
+    int32 lookback_count;
+    uint64 frames;
+    uint64 skipped;
+};
+
+pregate_t *
+pregate_init(int32 frame_samples, int32 samprate, float32 margin_db,
+             int32 lookback_ms, int32 hangover_ms)
+{
+    pregate_t *g = ckd_calloc(1, sizeof(*g));
+    int32 frame_ms = frame_samples * 1000 / samprate;
+
+    g->frame_samples = frame_samples;
+    g->margin_db = margin_db;
+    g->hangover = (hangover_ms + frame_ms - 1) / frame_ms;
+    g->n_lookback = (lookback_ms + frame_ms - 1) / frame_ms;
+    if (g->n_lookback < 1)
+        g->n_lookback = 1;
+    g->lookback = ckd_calloc((size_t)g->n_lookback * frame_samples, sizeof(int16));
+    g->lookback_n = ckd_calloc(g->n_lookback, sizeof(int32));
+    g->lookback_ns = ckd_calloc(g->n_lookback, sizeof(int64));
+
+    E_INFO("Pre-gate: %.1f dB over the noise floor, %d lookback and %d hangover frames\n",
+           margin_db, g->n_lookback, g->hangover);
+    return g;
+}
+
+pregate_result_t
+pregate_frame(pregate_t *g, int16 const *buf, int32 n, int64 ns)
+{
+    int64 sum = 0;
+    int32 i, crossings = 0, slot;
+    float32 energy_db, zcr;
+    uint8 speech;
+
+    /* Plain loops over int16; gcc vectorizes them at -O3. */
+    for (i = 0; i < n; ++i)
+        sum += (int32)buf[i] * buf[i];
+    for (i = 1; i < n; ++i)
+        crossings += (buf[i - 1] ^ buf[i]) < 0;
+
+    energy_db = 10.0f * log10f((float32)sum / (n > 0 ? n : 1) + 1.0f);
+    zcr = n > 1 ? (float32)crossings / (n - 1) : 0.0f;
+    ++g->frames;
+
+    if (!g->have_floor) {
+        g->floor_db = energy_db;
+        g->have_floor = TRUE;
+    }
+
+    speech = energy_db > MIN_SPEECH_DB
+        && (energy_db > g->floor_db + g->margin_db
+            || (energy_db > g->floor_db + g->margin_db / 2 && zcr > FRICATIVE_ZCR));
+
+    if (speech) {
+        int onset = g->hang_left == 0;
+
+        g->hang_left = g->hangover;
+        return onset && g->lookback_count > 0 ? PREGATE_ONSET : PREGATE_PASS;
+    }
+
+    /* Track the background: drop to quieter frames at once, rise slowly. */
+    if (energy_db < g->floor_db)
+        g->floor_db = energy_db;
+    else
+        g->floor_db += (energy_db - g->floor_db) * FLOOR_RISE;
+
+    if (g->hang_left > 0) {
+        --g->hang_left;
+        return PREGATE_PASS;
+    }
+
+    ++g->skipped;
+    if (n > g->frame_samples)
+        n = g->frame_samples;
+    slot = (g->lookback_head + g->lookback_count) % g->n_lookback;
+    if (g->lookback_count == g->n_lookback)
+        g->lookback_head = (g->lookback_head + 1) % g->n_lookback;
+    else
+        ++g->lookback_count;
+    memcpy(g->lookback + (size_t)slot * g->frame_samples, buf, n * sizeof(int16));
+    g->lookback_n[slot] = n;
+    g->lookback_ns[slot] = ns;
+    return PREGATE_SKIP;
+}
+
+int
+pregate_lookback(pregate_t *g, int32 i, int16 const **buf, int32 *n, int64 *ns)
+{
+    int32 slot;
+
+    if (i >= g->lookback_count) {
+        g->lookback_count = 0;
+        return -1;
+    }
+    slot = (g->lookback_head + i) % g->n_lookback;
+    *buf = g->lookback + (size_t)slot * g->frame_samples;
+    *n = g->lookback_n[slot];
+    *ns = g->lookback_ns[slot];
+    return 0;
+}
+
+void
+pregate_reset(pregate_t *g)
+{
+    g->lookback_count = 0;
+    g->hang_left = 0;
+}
+
+uint64
+pregate_frames(pregate_t *g)
+{
+    return g->frames;
+}
+
+uint64
+pregate_skipped(pregate_t *g)
+{
+    return g->skipped;
+}
+
+void
+pregate_free(pregate_t *g)
+{
+    if (g == NULL)
+        return;
+    ckd_free(g->lookback);
+    ckd_free(g->lookback_n);
+    ckd_free(g->lookback_ns);
+    ckd_free(g);
+}
@@ -0,0 +1,60 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * pregate.h - Energy/zero-crossing gate in front of the decoder
+ *
+ * Decides per frame, at a cost of one pass over the samples, whether the
+ * decoder needs to see it.  Frames quieter than an adaptive noise floor
+ * plus a margin are skipped; the last few of them are kept, so that when
+ * speech starts the decoder is first fed the lookback and the onset is not
+ * clipped.  After speech, frames keep flowing for a hangover period, which
+ * has to outlast the decoder's own end-of-speech detection (-vad_postspeech).
+ */
+
+#ifndef __PREGATE_H__
+#define __PREGATE_H__
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum pregate_result_e {
+    PREGATE_SKIP,       /* Silence: do not decode. */
+    PREGATE_ONSET,      /* Speech starts: decode the lookback, then this frame. */
+    PREGATE_PASS        /* Speech or hangover: decode. */
+} pregate_result_t;
+
+typedef struct pregate_s pregate_t;
+
+/**
+ * Gate for frames of frame_samples samples at samprate.  margin_db is how
+ * far above the noise floor a frame must be to count as speech.
+ */
+pregate_t *pregate_init(int32 frame_samples, int32 samprate, float32 margin_db,
+                        int32 lookback_ms, int32 hangover_ms);
+
+/** Classify one frame captured at ns.  Skipped frames are copied into the lookback. */
+pregate_result_t pregate_frame(pregate_t *g, int16 const *buf, int32 n, int64 ns);
+
+/**
+ * The i-th oldest lookback frame, after PREGATE_ONSET.  Returns 0 and fills
+ * buf, n and ns, or -1 once past the last one, which also empties the
+ * lookback.
+ */
+int pregate_lookback(pregate_t *g, int32 i, int16 const **buf, int32 *n, int64 *ns);
+
+/** Forget the lookback and any hangover, e.g. when the search restarts; the noise floor is kept. */
+void pregate_reset(pregate_t *g);
+
+/** Frames classified and frames skipped so far. */
+uint64 pregate_frames(pregate_t *g);
+uint64 pregate_skipped(pregate_t *g);
+
+void pregate_free(pregate_t *g);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PREGATE_H__ */
@@ -0,0 +1,153 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * reload.c - Keyword table and dictionary changes picked up while running
+ */
+
+#include <string.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "reload.h"
+
+/* Quiet time after a change before reloading, so a save in several writes loads once. */
+#define SETTLE_MS 200
+
+typedef struct watch_s {
+    int wd;                  /* Watch on the directory, since editors replace files. */
+    char *path;
+    char const *name;        /* Base name within the directory. */
+} watch_t;
+
+struct reload_s {
+    int fd;
+    watch_t table;
+    watch_t dict;
+    float64 threshold;
+    keywords_t *pending_kws; /* Atomic. */
+    int dict_changed;        /* Atomic. */
+    pthread_t thread;
+};
+
+static int
+watch_add(reload_t *r, watch_t *w, char const *path)
+{
+    char *dir, *slash;
+
+    w->wd = -1;
+    if (path == NULL)
+        return 0;
+    w->path = ckd_salloc(path);
+    dir = ckd_salloc(path);
+    if ((slash = strrchr(dir, '/')) != NULL) {
+        w->name = w->path + (slash - dir) + 1;
+        *slash = '\0';
+        if (dir[0] == '\0')
+            strcpy(dir, "/");
+    }
+    else {
+        w->name = w->path;
+        strcpy(dir, ".");
+    }
+    w->wd = inotify_add_watch(r->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (w->wd < 0)
+        E_ERROR_SYSTEM("Failed to watch %s", dir);
+    ckd_free(dir);
+    return w->wd < 0 ? -1 : 0;
+}
+
+static int
+watch_matches(watch_t const *w, struct inotify_event const *ev)
+{
+    return w->wd >= 0 && ev->wd == w->wd && ev->len > 0 && strcmp(ev->name, w->name) == 0;
+}
+
+/* Read the events that are ready; set the flags of the watched files among them. */
+static void
+read_events(reload_t *r, int *table, int *dict)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event const *ev;
+    ssize_t len;
+    char *p;
+
+    if ((len = read(r->fd, buf, sizeof(buf))) <= 0)
+        return;
+    for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+        ev = (struct inotify_event const *)p;
+        *table |= watch_matches(&r->table, ev);
+        *dict |= watch_matches(&r->dict, ev);
+    }
+}
+
+static void *
+reload_thread(void *arg)
+{
+    reload_t *r = arg;
+    struct pollfd pfd = { r->fd, POLLIN, 0 };
+    keywords_t *kws;
+    int table, dict;
+
+    for (;;) {
+        table = dict = FALSE;
+        read_events(r, &table, &dict);
+        if (!table && !dict)
+            continue;
+        while (poll(&pfd, 1, SETTLE_MS) > 0)
+            read_events(r, &table, &dict);
+
+        if (table) {
+            if ((kws = keywords_load(r->table.path, r->threshold)) == NULL) {
+                E_ERROR("Keeping the current keywords, %s is invalid\n", r->table.path);
+            }
+            else {
+                E_INFO("Reloading %d keywords from %s\n", kws->n_kw, r->table.path);
+                /* A table not yet taken by the decoder is replaced by the newer one. */
+                keywords_free(__atomic_exchange_n(&r->pending_kws, kws, __ATOMIC_ACQ_REL));
+            }
+        }
+        if (dict) {
+            E_INFO("Reloading dictionary %s\n", r->dict.path);
+            __atomic_store_n(&r->dict_changed, TRUE, __ATOMIC_RELEASE);
+        }
+    }
+    return NULL;
+}
+
+reload_t *
+reload_start(char const *table, char const *dict, float64 default_threshold)
+{
+    reload_t *r = ckd_calloc(1, sizeof(*r));
+
+    r->threshold = default_threshold;
+    if ((r->fd = inotify_init1(IN_CLOEXEC)) < 0) {
+        E_ERROR_SYSTEM("Failed to initialize inotify");
+        ckd_free(r);
+        return NULL;
+    }
+    /* A file that cannot be watched is only not reloaded. */
+    watch_add(r, &r->table, table);
+    watch_add(r, &r->dict, dict);
+    if (pthread_create(&r->thread, NULL, reload_thread, r) != 0)
+        E_FATAL("Failed to start the reload thread\n");
+    return r;
+}
+
+int
+reload_pending(reload_t *r)
+{
+    return __atomic_load_n(&r->pending_kws, __ATOMIC_RELAXED) != NULL
+        || __atomic_load_n(&r->dict_changed, __ATOMIC_RELAXED);
+}
+
+keywords_t *
+reload_take(reload_t *r, int *dict_changed)
+{
+    *dict_changed = __atomic_exchange_n(&r->dict_changed, FALSE, __ATOMIC_ACQ_REL);
+    return __atomic_exchange_n(&r->pending_kws, NULL, __ATOMIC_ACQ_REL);
+}
@@ -0,0 +1,43 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * reload.h - Keyword table and dictionary changes picked up while running
+ *
+ * A watcher thread follows the files with inotify and parses a changed
+ * keyword table itself, so the decode thread only swaps in the result, at
+ * an utterance boundary, and never stops listening to load anything.
+ */
+
+#ifndef __RELOAD_H__
+#define __RELOAD_H__
+
+#include <sphinxbase/prim_type.h>
+
+#include "keywords.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct reload_s reload_t;
+
+/**
+ * Start watching the keyword table and the dictionary; either may be NULL.
+ * The table is reparsed with default_threshold for keywords without one.
+ * Returns NULL if inotify is unavailable.
+ */
+reload_t *reload_start(char const *table, char const *dict, float64 default_threshold);
+
+/** Whether a change is waiting; cheap enough to call on every frame. */
+int reload_pending(reload_t *r);
+
+/**
+ * Take the pending change: the new keywords (owned by the caller) or NULL
+ * if the table did not change, and whether the dictionary did.
+ */
+keywords_t *reload_take(reload_t *r, int *dict_changed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RELOAD_H__ */
@@ -0,0 +1,64 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * spsc.c - Bounded single-producer single-consumer queue
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
+
+#include "spsc.h"
+
+spsc_t *
+spsc_init(uint32 n, uint32 elem_size)
+{
+    spsc_t *q = ckd_calloc(1, sizeof(*q));
+
+    for (q->size = 1; q->size < n; q->size <<= 1)
+        ;
+    q->elem_size = elem_size;
+    q->buf = ckd_calloc(q->size, elem_size);
+    if (sem_init(&q->items, 0, 0) < 0)
+        E_FATAL_SYSTEM("Failed to create queue semaphore");
+    return q;
+}
+
+int
+spsc_push(spsc_t *q, void const *elem)
+{
+    uint32 tail = q->tail;
+
+    /* head is only advanced by the consumer; a stale value merely looks fuller. */
+    if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == q->size)
+        return -1;
+    memcpy(q->buf + (size_t)(tail & (q->size - 1)) * q->elem_size, elem, q->elem_size);
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    sem_post(&q->items);
+    return 0;
+}
+
+void
+spsc_pop(spsc_t *q, void *elem)
+{
+    uint32 head = q->head;
+
+    while (sem_wait(&q->items) < 0) {
+        if (errno != EINTR)
+            E_FATAL_SYSTEM("Failed to wait on queue");
+    }
+    memcpy(elem, q->buf + (size_t)(head & (q->size - 1)) * q->elem_size, q->elem_size);
+    /* Release the slot only after copying it out. */
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void
+spsc_free(spsc_t *q)
+{
+    if (q == NULL)
+        return;
+    sem_destroy(&q->items);
+    ckd_free(q->buf);
+    ckd_free(q);
+}
@@ -0,0 +1,46 @@
+/* -*- c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * spsc.h - Bounded single-producer single-consumer queue
+ *
+ * Elements are copied in and out of a fixed ring.  Pushing never blocks or
+ * allocates, so a real-time producer (the capture thread) can hand work to
+ * a consumer that may fall behind; a full queue is reported and the
+ * producer decides what to drop.  The consumer sleeps on a semaphore.
+ */
+
+#ifndef __SPSC_H__
+#define __SPSC_H__
+
+#include <semaphore.h>
+
+#include <sphinxbase/prim_type.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct spsc_s {
+    uint32 size;       /* Slots, a power of two. */
+    uint32 elem_size;
+    uint32 head;       /* Next slot to pop; written by the consumer only. */
+    uint32 tail;       /* Next slot to push; written by the producer only. */
+    sem_t items;
+    char *buf;
+} spsc_t;
+
+/** A queue of at least n elements of elem_size bytes. */
+spsc_t *spsc_init(uint32 n, uint32 elem_size);
+
+/** Copy elem into the queue and wake the consumer.  Returns -1 if full. */
+int spsc_push(spsc_t *q, void const *elem);
+
+/** Block until an element is available and copy it out. */
+void spsc_pop(spsc_t *q, void *elem);
+
+void spsc_free(spsc_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SPSC_H__ */